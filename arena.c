@@ -0,0 +1,83 @@
+/** Arena to allocate all solver buffers of a (k, m) problem from one aligned block
+ *
+ * A block is only reallocated if a problem needs more memory than the block has,
+ * so a thread solving many problems pays no malloc cost per problem.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define ARENA_ALIGN     64              // Alignment of each buffer: 1 cache line
+#define ALIGN_UP(s)     (((s) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+#include <malloc.h>
+
+typedef struct
+{
+    char    *base;                      // Aligned block
+    size_t  size;                       // #bytes in the block
+    size_t  used;                       // #bytes carved out of the block
+    char    huge;                       // The block uses huge pages
+} arena;
+
+char hugePages;                         // Use huge pages for the arenas if possible
+
+/** Release the block of an arena
+ * 261018 Created
+ */
+void arenaFree(arena *a)
+{
+    if (a->base == NULL)
+        return;
+    if (a->huge)
+        VirtualFree(a->base, 0, MEM_RELEASE);
+    else
+        _aligned_free(a->base);
+    a->base = NULL;
+    a->size = 0;
+    a->used = 0;
+    a->huge = 0;
+}
+
+/** Ensure that the arena has a block of >= size bytes, and make it empty.
+ * The block is only reallocated if it is too small.
+ * Returns 0 if failed
+ * 261018 Created
+ */
+char arenaReserve(arena *a, size_t size, const char huge)
+{
+    size_t large;
+
+    a->used = 0;
+    if (a->base && (a->size >= size))
+        return 1;                       // Reuse the block
+    arenaFree(a);
+    size = ALIGN_UP(size);
+    if (huge && ((large = GetLargePageMinimum()) != 0))
+    {
+        size = (size + large - 1) / large * large;
+        a->base = (char*)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        a->huge = (a->base != NULL);
+    }
+    if (a->base == NULL)                // No huge pages (privilege), or not asked for
+        a->base = (char*)_aligned_malloc(size, ARENA_ALIGN);
+    if (a->base == NULL)
+        return 0;
+    a->size = size;
+    return 1;
+}
+
+/** Carve an aligned buffer of size bytes out of the arena
+ * Returns NULL if the block is too small
+ * 261018 Created
+ */
+void *arenaAlloc(arena *a, const size_t size)
+{
+    void *p;
+
+    if (a->used + ALIGN_UP(size) > a->size)
+        return NULL;
+    p = a->base + a->used;
+    a->used += ALIGN_UP(size);
+    return p;
+}
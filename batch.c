@@ -0,0 +1,491 @@
+/** Non-interactive batch runs: solve random instances with the parameters given as arguments
+ * on several threads, without prompts or pauses. Anomalies are logged per instance
+ * by their code, and the batch goes on.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+typedef struct
+{
+    unsigned k, m;                      // Problem size
+    unsigned repeat;                    // #instances
+    unsigned long long seed;            // Instance i is generated with seed + i
+    unsigned Nthreads;                  // #threads; 0: 1/processor
+    unsigned Npar;                      // #threads of the pool to solve 1 instance; 1: no pool
+    char     alg;                       // ALG_*
+    unsigned long long budgetNs, budgetOps;     // Budget of getDecomp(); 0: no budget
+    char     verify;                    // Replay and verify the schedule of the router
+    char     compact;                   // Compact the stages of the schedule of the router
+    char     fmt;                       // STATS_*: format of the records; STATS_NONE: only the summary;
+                                        // FMT_*: write the instances instead of solving them
+    const char *algName;                // -a as given
+    genSpec  gen;                       // Family of the instances; GEN_NONE: setRandom()
+    const char *out;                    // Path of the records; NULL: stdout
+    const char *trace;                  // Path of the event trace (trace.c); NULL: no trace
+} batchArgs;
+
+#define FMT_FCS         4               // Write the instances as .fcs files
+#define FMT_CORPUS      5               // Write the instances as requests of the solver service
+
+static batchArgs        bArgs;
+static volatile LONG    bNext;          // Next instance to solve
+static CRITICAL_SECTION bLock;          // Lock to add to bStats
+static runStats         bStats;         // Statistics of all threads
+
+/** Print how to use the program
+ * 261018 Created
+ */
+static void usage()
+{
+    puts("Usage: routeSwaps                                    Interactive\n"
+         "       routeSwaps [options]                          Batch run\n"
+         "       routeSwaps -sweep JOURNAL [options]           Resumable sweep (see sweep.c)\n"
+         "       routeSwaps -merge OUT|- JOURNAL...            Merge the journals of sweeps\n"
+         "       routeSwaps -serve [path|-] [T] [COSTS|-] [TABLE]  Solver service\n"
+         "       routeSwaps -table PATH K M                    Make a decomposition table (see table.c)\n"
+         "Options:\n"
+         "  -k K          #centres (default 10)\n"
+         "  -m M          #leafs/centre (default 5)\n"
+         "  -r R          #instances (default 500)\n"
+         "  -s S          Seed of the first instance (default 1)\n"
+         "  -t T          #threads (default: 1/processor, or 1 if -p is given)\n"
+         "  -p P          #threads to analyse 1 instance with, if k >= 48 (0: 1/processor) (default 1);\n"
+         "                the results do not depend on P\n"
+         "  -a ALG        simple, stages, cycles, decomp, or a router and decomp joined by '+';\n"
+         "                both = simple+decomp (default both)\n"
+         "  -g FAMILY     Instances of family uniform, cycles[:L,C], near[:P], local[:B] or delworst[:T],\n"
+         "                optionally +y for a random target (see gen.c) (default: setRandom())\n"
+         "  -c COSTS      Swap-cost model to route under, and to weigh the swaps by (see cost.c)\n"
+         "                (default: every swap costs 1)\n"
+         "  -d TABLE      Decomposition table for getDecomp() to look up small residuals in (see table.c)\n"
+         "  -b BUDGET     Budget of getDecomp(): <N>us, <N>ms, <N>s or <N>ops, then it finishes\n"
+         "                greedily (default: no budget)\n"
+         "  -v            Replay the schedule of the router and verify it (disjoint swaps per stage,\n"
+         "                edges of the star graph, depth, Ns, Nsb, and each label in its star of y:\n"
+         "                the routers sort to the star level, so the order within a star is not checked)\n"
+         "  -C            Compact the stages of the schedule of the router (see schedule.c); depthR is\n"
+         "                its depth before\n"
+         "  -f FMT        text (summary only), csv, jsonl or bin (1 record/instance) (default text);\n"
+         "                fcs (PATH<seed>.fcs) or corpus (requests of -serve): write the instances\n"
+         "  -o PATH       File to write the records to (default stdout)\n"
+         "  -T PATH       Trace the run to Chrome trace-event JSON file PATH (built with TRACE)\n"
+         "Sweep options: -r, -s, -t, -a, -c, -b, -v as above, and\n"
+         "  -k K[,K..]    #centres of the points of the sweep (default 10)\n"
+         "  -m M[,M..]    #leafs/centre of the points of the sweep (default 5)\n"
+         "  -z Z          #seeds per shard (default 100)\n"
+         "  -w I/N        Solve the shards of process I of N (default 0/1)");
+}
+
+/** Parse the arguments of a batch run into bArgs
+ * Returns 0 if they are invalid
+ * 261018 Created
+ */
+static char parseBatchArgs(int argc, char **argv)
+{
+    int i;
+    const char *v;
+
+    bArgs.k        = 10;
+    bArgs.m        = SET_M;
+    bArgs.repeat   = REPEAT;
+    bArgs.seed     = 1;
+    bArgs.Nthreads = 0;
+    bArgs.Npar     = 1;
+    bArgs.alg      = ALG_SIMPLE | ALG_DECOMP;
+    bArgs.algName  = "both";
+    bArgs.gen.fam  = GEN_NONE;
+    bArgs.fmt      = STATS_NONE;
+    bArgs.out      = NULL;
+    bArgs.trace    = NULL;
+    bArgs.verify   = 0;
+    bArgs.compact  = 0;
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-v"))
+        {
+            bArgs.verify = 1;
+            continue;
+        }
+        if (!strcmp(argv[i], "-C"))
+        {
+            bArgs.compact = 1;
+            continue;
+        }
+        if ( (argv[i][0] != '-') || (argv[i][1] == 0) || argv[i][2] || (i + 1 == argc) )
+            return 0;
+        v = argv[++i];
+        switch (argv[i-1][1])
+        {
+        case 'k':
+            bArgs.k = strtoul(v, NULL, 10);
+            break;
+        case 'm':
+            bArgs.m = strtoul(v, NULL, 10);
+            break;
+        case 'r':
+            bArgs.repeat = strtoul(v, NULL, 10);
+            break;
+        case 's':
+            bArgs.seed = strtoull(v, NULL, 10);
+            break;
+        case 't':
+            bArgs.Nthreads = strtoul(v, NULL, 10);
+            break;
+        case 'p':
+            bArgs.Npar = strtoul(v, NULL, 10);
+            break;
+        case 'a':
+            if ((bArgs.alg = parseAlg(v)) == 0)
+                return 0;
+            bArgs.algName = v;
+            break;
+        case 'g':
+            if (!parseGen(v, &bArgs.gen))
+                return 0;
+            break;
+        case 'c':
+            costFree(costDefault);
+            if ((costDefault = costLoad(v)) == NULL)
+                return 0;
+            break;
+        case 'd':
+            if (!tabLoad(v))
+                return 0;
+            break;
+        case 'b':
+            if (!parseBudget(v, &bArgs.budgetNs, &bArgs.budgetOps))
+                return 0;
+            break;
+        case 'f':
+            if (!strcmp(v, "text"))
+                bArgs.fmt = STATS_NONE;
+            else if (!strcmp(v, "csv"))
+                bArgs.fmt = STATS_CSV;
+            else if (!strcmp(v, "jsonl"))
+                bArgs.fmt = STATS_JSONL;
+            else if (!strcmp(v, "bin"))
+                bArgs.fmt = STATS_BIN;
+            else if (!strcmp(v, "fcs"))
+                bArgs.fmt = FMT_FCS;
+            else if (!strcmp(v, "corpus"))
+                bArgs.fmt = FMT_CORPUS;
+            else
+                return 0;
+            break;
+        case 'o':
+            bArgs.out = v;
+            break;
+#ifdef TRACE
+        case 'T':
+            bArgs.trace = v;
+            break;
+#endif
+        default:
+            return 0;
+        }
+    }
+    return (bArgs.k > 0) && (bArgs.m > 0) && (bArgs.repeat <= LONG_MAX / 2);
+}
+
+/** Generate the instance of r->seed in family g (NULL or GEN_NONE: setRandom()) by solver rs into
+ * xs, ys (n labels each), and set up instance in with them
+ * 261018 Created from solveRec()
+ */
+static void genRec(rsSolver *rs, uint32_t *xs, uint32_t *ys, const genSpec *g, const instRec *r, rsInstance *in)
+{
+    memset(in, 0, sizeof(rsInstance));
+    in->size = sizeof(rsInstance);
+    in->x0   = xs;
+    if ( (g == NULL) || (g->fam == GEN_NONE) )
+        rsRandom(rs, r->seed, xs);
+    else
+    {
+        rsGenerate(rs, g->fam | (g->randY ? RS_GEN_Y : 0), g->p1, g->p2, r->seed, xs, ys);
+        in->y = g->randY ? ys : NULL;
+    }
+}
+
+/** Fill in the results res of an instance in its record r
+ * 261018 Created from solveRec()
+ */
+static void storeRec(const rsResult *res, instRec *r)
+{
+    r->alpha   = res->alpha;
+    r->beta    = res->beta;
+    r->depth   = res->depth;
+    r->depthR  = res->depthR;
+    r->Ns      = res->Ns;
+    r->Nsb     = res->Nsb;
+    r->wCost   = res->wCost;
+    r->wDepth  = res->wDepth;
+    r->tRoute  = res->tRoute;
+    r->tDecomp = res->tDecomp;
+    r->err     = res->err;
+    r->partial = res->partial;
+}
+
+/** Solve the instance of r->seed in family g (NULL or GEN_NONE: setRandom()) with the algorithms alg
+ * (RS_ALG_*, RS_VERIFY, RS_COMPACT) by solver rs, using xs, ys (n labels each) for its labels and target, and fill in
+ * the rest of record r
+ * 261018 Created
+ * 261018 Trace it as a span
+ */
+static void solveRec(rsSolver *rs, uint32_t *xs, uint32_t *ys, const genSpec *g, const uint32_t alg, instRec *r)
+{
+    rsInstance in;
+    rsResult res;
+
+    genRec(rs, xs, ys, g, r, &in);
+    res.size = sizeof(rsResult);
+#ifdef OP_COUNT
+    opReset();
+#endif
+    TR_BEGIN(TN_INSTANCE, r->seed);
+    rsSolve(rs, alg, &in, &res);
+    TR_END(TN_INSTANCE);
+    storeRec(&res, r);
+#ifdef OP_COUNT
+    opStore(r->ops);
+#endif
+}
+
+/** Decompose the L <= LANES instances of the records r[0], .., r[L-1] in 1 call of rsSolveBatch(),
+ * which solves them in lockstep (lanes.c), using xs, ys (L*n labels each) for their labels and
+ * targets, and fill in the rest of their records
+ * 261018 Created
+ */
+static void solveLanes(rsSolver *rs, uint32_t *xs, uint32_t *ys, const unsigned L, instRec *r)
+{
+    rsInstance in[LANES];
+    rsResult res[LANES];
+    unsigned l;
+    const unsigned nn = rsNodes(rs);
+
+    for (l = 0; l < L; l++)
+    {
+        genRec(rs, &xs[l * nn], &ys[l * nn], &bArgs.gen, &r[l], &in[l]);
+        res[l].size = sizeof(rsResult);
+    }
+    TR_BEGIN(TN_INSTANCE, r[0].seed);
+    rsSolveBatch(rs, RS_ALG_DECOMP, in, res, L);
+    TR_END(TN_INSTANCE);
+    for (l = 0; l < L; l++)
+        storeRec(&res[l], &r[l]);
+}
+
+/** Batch worker thread: solve instances until all are done, through the library API. Without
+ * OP_COUNT, a decomposition of k <= LANE_MAX_K takes LANES instances at a time, to solve them in
+ * lockstep; the operation counters are per instance, so with OP_COUNT they are solved 1 by 1.
+ * 261018 Created
+ * 261018 Solve by rsSolve()
+ * 261018 Take LANES instances at a time to decompose in lockstep
+ */
+static DWORD WINAPI batchWorker(LPVOID arg)
+{
+    unsigned i, l, L, Nl = 1;
+    uint32_t *xs, *ys;
+    rsSolver *rs;
+    instRec r[LANES];
+    runStats *s;
+
+    (void)arg;
+#ifndef OP_COUNT
+    if ( (bArgs.alg == ALG_DECOMP) && (bArgs.k <= LANE_MAX_K) )
+        Nl = LANES;
+#endif // OP_COUNT
+    if ((s = (runStats*)calloc(1, sizeof(runStats))) == NULL)
+        return 1;
+    if ((rs = rsCreate(bArgs.k, bArgs.m)) == NULL)
+    {
+        rsThreadCleanup();
+        free(s);
+        return 1;
+    }
+    xs = (uint32_t*)malloc(Nl * rsNodes(rs) * sizeof(uint32_t));
+    ys = (uint32_t*)malloc(Nl * rsNodes(rs) * sizeof(uint32_t));
+    if ( (xs == NULL) || (ys == NULL) )
+    {
+        free(xs);
+        free(ys);
+        rsDestroy(rs);
+        rsThreadCleanup();
+        free(s);
+        return 1;
+    }
+    rsSetBudget(rs, bArgs.budgetNs, bArgs.budgetOps);
+    while ((i = InterlockedExchangeAdd(&bNext, Nl)) < bArgs.repeat)
+    {
+        L = (bArgs.repeat - i < Nl) ? bArgs.repeat - i : Nl;
+        for (l = 0; l < L; l++)
+        {
+            memset(&r[l], 0, sizeof(instRec));
+            r[l].seed = bArgs.seed + i + l;
+            r[l].k    = bArgs.k;
+            r[l].m    = bArgs.m;
+        }
+        if (Nl > 1)
+            solveLanes(rs, xs, ys, L, r);
+        else
+            solveRec(rs, xs, ys, &bArgs.gen, bArgs.alg | (bArgs.verify ? RS_VERIFY : 0) | (bArgs.compact ? RS_COMPACT : 0), r);
+
+        for (l = 0; l < L; l++)
+        {
+            statsAdd(s, &r[l]);
+            statsWrite(&r[l]);
+            if ( r[l].err && (bArgs.fmt == STATS_NONE) )
+            {
+                EnterCriticalSection(&bLock);
+                printf("! Instance %u (seed %llu): %s\n", i + l, r[l].seed, rsErrName(r[l].err));
+                LeaveCriticalSection(&bLock);
+            }
+        }
+    }
+
+    EnterCriticalSection(&bLock);
+    statsMerge(&bStats, s);
+    LeaveCriticalSection(&bLock);
+    free(s);
+    free(xs);
+    free(ys);
+    rsDestroy(rs);
+    rsThreadCleanup();
+    return 0;
+}
+
+/** Write the instances of the batch instead of solving them: as .fcs files bArgs.out<seed>.fcs
+ * (FMT_FCS), or as requests of the solver service to bArgs.out (FMT_CORPUS)
+ * Returns the exit code
+ * 261018 Created
+ */
+static int writeBatch()
+{
+    unsigned i, j;
+    unsigned *xs, *ys;
+    unsigned long long seed;
+    char path[LINE_LEN], id[ID_LEN];
+    FILE *fp = stdout;
+    int ret = EXIT_FAILURE;
+
+    xs = (unsigned*)malloc(n * sizeof(unsigned));
+    ys = (unsigned*)malloc(n * sizeof(unsigned));
+    if ( (xs == NULL) || (ys == NULL) )
+        goto done;
+    if ( (bArgs.fmt == FMT_CORPUS) && (bArgs.out != NULL) && strcmp(bArgs.out, "-")
+            && (fp = fopen(bArgs.out, "w")) == NULL )
+    {
+        printf("! Unable to use the path \"%s\"\n", bArgs.out);
+        goto done;
+    }
+    for (i = 0; i < bArgs.repeat; i++)
+    {
+        seed = bArgs.seed + i;
+        if (bArgs.gen.fam != GEN_NONE)
+        {
+            if (!genInstance(&bArgs.gen, seed, xs, ys))
+                goto done;
+        }
+        else
+        {
+            srnd(seed);
+            setRandom(x0);
+            for (j = 0; j < n; j++)
+            {
+                xs[j] = LAB(x0, j);
+                ys[j] = j + 1;
+            }
+        }
+        if (bArgs.fmt == FMT_FCS)
+        {
+            snprintf(path, LINE_LEN, "%s%llu.fcs", bArgs.out ? bArgs.out : "p", seed);
+            if (!genWriteFcs(path, xs, ys))
+                goto done;
+            continue;
+        }
+        snprintf(id, ID_LEN, "%s-%llu", bArgs.gen.fam ? genName[(int)bArgs.gen.fam] : "random", seed);
+        genWriteReq(fp, id, bArgs.algName, xs, ys);
+    }
+    ret = EXIT_SUCCESS;
+
+done:
+    if (fp != stdout)
+        fclose(fp);
+    free(xs);
+    free(ys);
+    return ret;
+}
+
+/** Run a batch with the arguments argv
+ * Returns the exit code
+ * 261018 Created
+ */
+int runBatch(int argc, char **argv)
+{
+    unsigned i;
+    unsigned long long t0;
+    HANDLE *th;
+
+    if (!parseBatchArgs(argc, argv))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (!setProblem(bArgs.k, bArgs.m))
+    {
+        printf("! Cannot set up a problem with k = %u, m = %u\n", bArgs.k, bArgs.m);
+        return EXIT_FAILURE;
+    }
+    if (bArgs.fmt >= FMT_FCS)
+    {
+        i = writeBatch();
+        freeMem();
+        return i;
+    }
+    freeMem();
+    if (bArgs.Npar != 1)
+    {
+        parStart(bArgs.Npar);           // Large instances: parallelize within the instance
+        if (bArgs.Nthreads == 0)
+            bArgs.Nthreads = 1;
+    }
+    if (bArgs.Nthreads == 0)
+        bArgs.Nthreads = getNcpu();
+    pauseOnErr = 0;
+    th = (HANDLE*)malloc(bArgs.Nthreads * sizeof(HANDLE));
+    if ( (th == NULL) || !statsOpen(bArgs.out, bArgs.fmt) )
+    {
+        free(th);
+        return EXIT_FAILURE;
+    }
+    InitializeCriticalSection(&bLock);
+#ifdef TRACE
+    if (bArgs.trace != NULL)
+        trStart(0);
+#endif
+
+    t0 = nsNow();
+    for (i = 0; i < bArgs.Nthreads; i++)
+        th[i] = CreateThread(NULL, 0, batchWorker, NULL, 0, NULL);
+    for (i = 0; i < bArgs.Nthreads; i++)
+    {
+        if (th[i] == NULL)
+            continue;
+        WaitForSingleObject(th[i], INFINITE);
+        CloseHandle(th[i]);
+    }
+    free(th);
+    DeleteCriticalSection(&bLock);
+    statsClose();
+    parStop();
+#ifdef TRACE
+    if (bArgs.trace != NULL)
+        trExport(bArgs.trace, bArgs.m);
+#endif
+
+    if ( (bArgs.fmt == STATS_NONE) || (bArgs.out != NULL) )   // Don't mix the summary with the records
+    {
+        printf("> %llu instances, k = %u, m = %u, seed %llu, %.3f s\n", bStats.N, bArgs.k, bArgs.m, bArgs.seed, (nsNow() - t0) / 1e9);
+        printStats(&bStats);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/** Swap-cost model: the cost of a cheap centre-leaf swap (a) and of an expensive centre-centre
+ * swap (b), optionally per star and per ordered pair of stars, loaded from a text file:
+ *   c ...          Comment
+ *   a C            Cost of a centre-leaf swap (default 1)
+ *   a G C          Cost of a centre-leaf swap in star G
+ *   b C            Cost of a centre-centre swap (default 1)
+ *   b G H C        Cost of a centre-centre swap from centre G to centre H; also from H to G,
+ *                  unless that is given too
+ * Stars are numbered from 1, as they are printed; entries of stars > k do not apply to a problem
+ * of k centres. A centre-centre swap is recorded in its cheaper direction, and routeCycles() starts
+ * each cycle at the axis of which the reflections cost least.
+ *
+ * The weighted cost wCost of a schedule is the sum of the costs of its swaps, and its weighted depth
+ * wDepth the sum over its stages of the cost of the most expensive swap in the stage: the time it
+ * runs if the swaps of a stage run in parallel. Without a model every swap costs 1, so wCost = Ns and
+ * wDepth = depth.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define COST_LINE_LEN   256             // Max length of a line of a cost file
+#define COST_LEAF       UINT_MAX        // Star pair of an entry of a centre-leaf swap
+
+typedef struct
+{
+    unsigned g, h;                      // Stars; h = COST_LEAF for a centre-leaf swap in star g
+    unsigned c;                         // Cost
+} costEntry;
+
+typedef struct
+{
+    unsigned a, b;                      // Cost of a centre-leaf, centre-centre swap
+    unsigned Ne;                        // #entries per star and per star pair
+    costEntry *e;                       // Entries, in the order of the file
+    unsigned sum;                       // Checksum of the model
+} costModel;
+
+costModel *costDefault;                 // Model of the threads that set none; NULL: every swap costs 1
+TLS const costModel *costModelT;        // Model of this thread; NULL: costDefault
+static TLS const costModel *cBuilt;     // Model the tables are built for
+static TLS unsigned cK;                 // #centres the tables are built for; 0: none
+static TLS unsigned cA0, cB0;           // Cost of a centre-leaf, centre-centre swap if it is not per star, pair
+static TLS unsigned *cA;                // cA[g] = cost of a centre-leaf swap in star g
+static TLS unsigned *cB;                // cB[g*k + h] = cost of a centre-centre swap g -> h
+static TLS unsigned cACap, cBCap;
+static TLS const unsigned *costA, *costB;   // Tables in use: cA, cB, or NULL if costs are not per star, pair
+
+/** Free cost model cm
+ * 261018 Created
+ */
+void costFree(costModel *cm)
+{
+    if (cm == NULL)
+        return;
+    free(cm->e);
+    free(cm);
+}
+
+/** Load the cost model of file path
+ * Returns NULL if failed
+ * 261018 Created
+ */
+costModel *costLoad(const char *path)
+{
+    char line[COST_LINE_LEN];
+    unsigned v[3], ln = 0, Nv, cap = 0, i;
+    costEntry *p;
+    costModel *cm;
+    FILE *fp;
+
+    if ((fp = fopen(path, "rt")) == NULL)
+    {
+        printf("! Unable to use the path \"%s\"\n", path);
+        return NULL;
+    }
+    if ((cm = (costModel*)calloc(1, sizeof(costModel))) == NULL)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    cm->a = cm->b = 1;
+    while (fgets(line, COST_LINE_LEN, fp) != NULL)
+    {
+        ln++;
+        if ( (line[0] == 'c') || (line[0] == '\n') || (line[0] == '\r') || (line[0] == 0) )
+            continue;
+        Nv = sscanf(line + 1, "%u %u %u", &v[0], &v[1], &v[2]);
+        if ( (line[0] == 'a') && (Nv == 1) )
+            cm->a = v[0];
+        else if ( (line[0] == 'b') && (Nv == 1) )
+            cm->b = v[0];
+        else if ( ((line[0] == 'a') && (Nv == 2) && v[0]) || ((line[0] == 'b') && (Nv == 3) && v[0] && v[1] && (v[0] != v[1])) )
+        {
+            if (cm->Ne == cap)
+            {
+                cap = cap ? 2 * cap : 64;
+                if ((p = (costEntry*)realloc(cm->e, cap * sizeof(costEntry))) == NULL)
+                {
+                    puts("! Out of memory");
+                    break;
+                }
+                cm->e = p;
+            }
+            p = &cm->e[cm->Ne++];
+            p->g = v[0] - 1;
+            p->h = (line[0] == 'a') ? COST_LEAF : v[1] - 1;
+            p->c = (line[0] == 'a') ? v[1] : v[2];
+        }
+        else
+        {
+            printf("! \"%s\", line %u: expected a C, a G C, b C or b G H C with stars G != H >= 1\n", path, ln);
+            break;
+        }
+    }
+    if (!feof(fp))
+    {
+        fclose(fp);
+        costFree(cm);
+        return NULL;
+    }
+    fclose(fp);
+    cm->sum = 0x811C9DC5;               // FNV-1a over the costs
+    for (i = 0; i < 3 * cm->Ne + 2; i++)
+        cm->sum = (cm->sum ^ (i < 2 ? (i ? cm->b : cm->a) : ((unsigned*)cm->e)[i-2])) * 0x01000193;
+    return cm;
+}
+
+/** Get the checksum of the cost model in use: 0 if every swap costs 1
+ * 261018 Created
+ */
+unsigned costSum()
+{
+    const costModel *cm = costModelT ? costModelT : costDefault;
+
+    return cm ? cm->sum : 0;
+}
+
+/** Use cost model cm on this thread; NULL: costDefault
+ * 261018 Created
+ */
+void costUse(const costModel *cm)
+{
+    if (cm == costModelT)
+        return;
+    costModelT = cm;
+    cK = 0;                             // Build the tables again: cm can be at the address of a freed model
+}
+
+/** Build the cost tables of this thread for the model in use and k centres, if not done yet
+ * 261018 Created
+ */
+static void costBind()
+{
+    unsigned i, g, h;
+    const costModel *cm = costModelT ? costModelT : costDefault;
+    char perStar = 0, perPair = 0;
+
+    if ( (cBuilt == cm) && (cK == k) )
+        return;
+    cBuilt = cm;
+    cK     = k;
+    cA0    = cm ? cm->a : 1;
+    cB0    = cm ? cm->b : 1;
+    costA  = costB = NULL;
+    for (i = 0; cm && (i < cm->Ne); i++)
+        if ( (cm->e[i].g < k) && (cm->e[i].h == COST_LEAF) )
+            perStar = 1;
+        else if ( (cm->e[i].g < k) && (cm->e[i].h < k) )
+            perPair = 1;
+    if ( perStar && (cACap < k) )
+    {
+        free(cA);
+        cACap = (cA = (unsigned*)malloc(k * sizeof(unsigned))) ? k : 0;
+    }
+    if ( perPair && (cBCap < k * k) )
+    {
+        free(cB);
+        cBCap = (cB = (unsigned*)malloc((size_t)k * k * sizeof(unsigned))) ? k * k : 0;
+    }
+    if ( (perStar && !cACap) || (perPair && !cBCap) )
+    {
+        anomaly(ERR_NO_MEM, "! Cost: out of memory\n");
+        return;                         // Every swap of a type costs the same
+    }
+
+    if (perStar)
+    {
+        for (g = 0; g < k; g++)
+            cA[g] = cA0;
+        for (i = 0; i < cm->Ne; i++)
+            if ( (cm->e[i].g < k) && (cm->e[i].h == COST_LEAF) )
+                cA[cm->e[i].g] = cm->e[i].c;
+        costA = cA;
+    }
+    if (perPair)
+    {
+        for (g = 0; g < k * k; g++)
+            cB[g] = UINT_MAX;
+        for (i = 0; i < cm->Ne; i++)    // The directions given
+            if ( (cm->e[i].g < k) && (cm->e[i].h < k) )
+                cB[cm->e[i].g * k + cm->e[i].h] = cm->e[i].c;
+        for (g = 0; g < k; g++)         // The others: as the reverse direction, else the default
+            for (h = 0; h < k; h++)
+                if (cB[g * k + h] == UINT_MAX)
+                    cB[g * k + h] = (cB[h * k + g] != UINT_MAX) ? cB[h * k + g] : cB0;
+        costB = cB;
+    }
+}
+
+/** Get the cost of a centre-centre swap of stars g, h, in its cheaper direction
+ * 261018 Created
+ */
+static inline unsigned costPair(const unsigned g, const unsigned h)
+{
+    if (costB == NULL)
+        return cB0;
+    return costB[g * k + h] < costB[h * k + g] ? costB[g * k + h] : costB[h * k + g];
+}
+
+/** Get the cost of swap (i, j) as it is recorded: a centre-centre swap in its cheaper direction
+ * 261018 Created
+ */
+static unsigned costOf(const unsigned i, const unsigned j)
+{
+    const unsigned gi = i/(m+1), gj = j/(m+1);
+
+    costBind();
+    if (gi == gj)
+        return costA ? costA[gi] : cA0;
+    return costPair(gi, gj);
+}
+
+/** Add swap (*i, *j) of the current stage to the weighted cost and depth. A centre-centre swap is
+ * turned into its cheaper direction.
+ * Returns its cost
+ * 261018 Created
+ */
+static unsigned costSwap(unsigned *i, unsigned *j)
+{
+    unsigned c, t;
+    const unsigned gi = *i/(m+1), gj = *j/(m+1);
+
+    costBind();
+    if (gi == gj)
+        c = costA ? costA[gi] : cA0;
+    else
+    {
+        c = cB0;
+        if ( (costB != NULL) && ((c = costB[gi * k + gj]) > costB[gj * k + gi]) )
+        {
+            c  = costB[gj * k + gi];
+            t  = *i;
+            *i = *j;
+            *j = t;
+        }
+    }
+    if (depth != wStage)
+    {
+        wStage    = depth;
+        wStageMax = 0;
+    }
+    if (c > wStageMax)
+    {
+        wDepth   += c - wStageMax;
+        wStageMax = c;
+    }
+    wCost += c;
+    return c;
+}
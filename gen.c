@@ -0,0 +1,254 @@
+/** Seeded generator of structured instances (x0, y) of the (k, m) problem, per family:
+ *   uniform        Uniform random permutation (setRandom() is not uniform)
+ *   cycles:L,C     C cycles through L random stars each (default L = k, C = m+1): few long cycles
+ *   near:P         Sorted, except P% of the labels (default 5), which are shuffled among their nodes
+ *   local:B        Labels shuffled within blocks of B stars (default 1: star-local)
+ *   delworst:T     T 5-cycles (default: all nodes) over 5 layers of stars (star g in layer g % 5),
+ *                  each from layer to layer: all cycles have a length 5j, so there are no shorter
+ *                  cycles, nor stars with 1 in- or out-neighbour for ruleB(), ruleC(), and delCycles(5)
+ *                  restarts from star 0 after each of its many removals
+ * A family followed by "+y" gets a uniform random target y; otherwise y = (1, ..., n).
+ * x0 starts as y, and the family moves the labels over the nodes, so a cycle through stars
+ * g1 -> g2 -> .. adds 1 to W(g1, g2), .. Labels are in [1, n].
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define GEN_NONE        0               // Families
+#define GEN_UNIFORM     1
+#define GEN_CYCLES      2
+#define GEN_NEAR        3
+#define GEN_LOCAL       4
+#define GEN_DELWORST    5
+#define NGEN            6
+
+static const char *genName[NGEN] = {"", "uniform", "cycles", "near", "local", "delworst"};
+
+typedef struct
+{
+    char     fam;                       // GEN_*
+    unsigned p1, p2;                    // Parameters of the family; 0: default
+    char     randY;                     // Uniform random target y
+} genSpec;
+
+static TLS unsigned *gNode;             // gNode[g(m+1) + i] = i-th free node of star g, in random order
+static TLS unsigned *gUsed;             // #nodes of star g in a cycle
+static TLS unsigned *gStar;             // Stars, in random order
+static TLS unsigned gCap, gCapK;        // #nodes gNode can hold, #stars gUsed, gStar can hold
+
+/** Parse family s: name[:P[,Q]][+y]
+ * Returns 0 if invalid
+ * 261018 Created
+ */
+char parseGen(const char *s, genSpec *g)
+{
+    size_t len = strcspn(s, ":+");
+    char *end;
+
+    memset(g, 0, sizeof(genSpec));
+    for (g->fam = 1; (g->fam < NGEN) && ((strlen(genName[(int)g->fam]) != len) || strncmp(s, genName[(int)g->fam], len)); g->fam++);
+    if (g->fam == NGEN)
+        return 0;
+    s += len;
+    if (*s == ':')
+    {
+        g->p1 = strtoul(s + 1, &end, 10);
+        s = end;
+        if (*s == ',')
+        {
+            g->p2 = strtoul(s + 1, &end, 10);
+            s = end;
+        }
+    }
+    if (!strcmp(s, "+y"))
+        g->randY = 1;
+    else if (*s)
+        return 0;
+    return 1;
+}
+
+/** Shuffle the N values of v (Fisher-Yates)
+ * 261018 Created
+ */
+static void shuffle(unsigned *v, const unsigned N)
+{
+    unsigned i, j, t;
+
+    for (i = N; i > 1; i--)
+    {
+        j = rnd() % i;
+        t = v[i-1];
+        v[i-1] = v[j];
+        v[j] = t;
+    }
+}
+
+/** Put a cycle through the L stars gs on xs: a free node of each star gets the label of the node
+ * of the next star
+ * Returns 0 if a star has no free node left
+ * 261018 Created
+ */
+static char genCycle(unsigned *xs, const unsigned *gs, const unsigned L)
+{
+    unsigned i, a, b, t;
+
+    for (i = 0; i < L; i++)
+        if (gUsed[gs[i]] > m)
+            return 0;
+    a = gNode[gs[0] * (m+1) + gUsed[gs[0]]++];
+    t = xs[a];
+    for (i = 1; i < L; i++)
+    {
+        b = gNode[gs[i] * (m+1) + gUsed[gs[i]]++];
+        xs[a] = xs[b];
+        a = b;
+    }
+    xs[a] = t;
+    return 1;
+}
+
+/** Put up to C cycles through L random stars of the Ng stars g0, .., g0+Ng-1 on xs
+ * 261018 Created
+ */
+static void genCycles(unsigned *xs, const unsigned g0, const unsigned Ng, const unsigned L, const unsigned C)
+{
+    unsigned c, i, fails = 0;
+
+    for (c = 0; (c < C) && (fails < 8 * Ng); )
+    {
+        for (i = 0; i < Ng; i++)
+            gStar[i] = g0 + i;
+        shuffle(gStar, Ng);
+        if (genCycle(xs, gStar, L))
+            c++;
+        else
+            fails++;                    // Some star is full: try other stars
+    }
+}
+
+/** Generate the instance of seed in family g: labels xs, target ys (n labels in [1, n] each)
+ * The problem (k, m) must be set up.
+ * Returns 0 if out of memory
+ * 261018 Created
+ */
+char genInstance(const genSpec *g, const unsigned long long seed, unsigned *xs, unsigned *ys)
+{
+    unsigned i, b, B, N, t, L, T;
+    const unsigned m1 = m + 1;
+
+    if ( (gCap < n) || (gCapK < k) )
+    {
+        free(gNode);
+        free(gUsed);
+        free(gStar);
+        gCap  = gCapK = 0;
+        gNode = (unsigned*)malloc(n * sizeof(unsigned));
+        gUsed = (unsigned*)malloc(k * sizeof(unsigned));
+        gStar = (unsigned*)malloc(k * sizeof(unsigned));
+        if (!gNode || !gUsed || !gStar)
+            return 0;
+        gCap  = n;
+        gCapK = k;
+    }
+    srnd(seed);
+    for (i = 0; i < n; i++)
+        ys[i] = i + 1;
+    if (g->randY)
+        shuffle(ys, n);
+    memcpy(xs, ys, n * sizeof(unsigned));
+    for (i = 0; i < n; i++)
+        gNode[i] = i;
+    for (b = 0; b < k; b++)
+        shuffle(&gNode[b * m1], m1);
+    memset(gUsed, 0, k * sizeof(unsigned));
+
+    switch (g->fam)
+    {
+    case GEN_UNIFORM:
+        shuffle(xs, n);
+        break;
+    case GEN_CYCLES:
+        L = g->p1 ? g->p1 : k;
+        L = L < 2 ? 2 : (L > k ? k : L);
+        if (L <= k)                     // A single star has no cycles
+            genCycles(xs, 0, k, L, g->p2 ? g->p2 : m1);
+        break;
+    case GEN_NEAR:
+        N = (unsigned)((unsigned long long)n * (g->p1 ? g->p1 : 5) / 100);
+        N = N > n ? n : N;
+        shuffle(gNode, n);              // Displace the labels of the first N nodes of a random order
+        for (i = N; i > 1; i--)
+        {
+            b = rnd() % i;
+            t = xs[gNode[i-1]];
+            xs[gNode[i-1]] = xs[gNode[b]];
+            xs[gNode[b]] = t;
+        }
+        break;
+    case GEN_LOCAL:
+        B = g->p1 ? g->p1 : 1;
+        for (b = 0; b < k; b += B)
+            shuffle(&xs[b * m1], ((b + B < k) ? B : k - b) * m1);
+        break;
+    case GEN_DELWORST:
+        if (k < 5)
+            break;
+        T = g->p1 ? g->p1 : k / 5 * m1;
+        for (i = 0, N = 0; (i < T) && (N < 8 * k); )    // 5-cycles through the 5 layers in order
+        {
+            for (b = 0; b < 5; b++)
+                gStar[b] = b + 5 * (rnd() % ((k - b + 4) / 5));
+            if (genCycle(xs, gStar, 5))
+                i++;
+            else
+                N++;                    // Some star is full: try other stars
+        }
+        break;
+    }
+    return 1;
+}
+
+/** Write instance (xs, ys) as .fcs file path, as save() does; y is only written if it is not
+ * (1, ..., n)
+ * Returns 0 if failed
+ * 261018 Created
+ */
+char genWriteFcs(const char *path, const unsigned *xs, const unsigned *ys)
+{
+    unsigned i;
+    FILE *fp;
+
+    if ((fp = fopen(path, "w")) == NULL)
+    {
+        printf("! Unable to use the path \"%s\"\n", path);
+        return 0;
+    }
+    fprintf(fp, "c Generated by routeSwaps\nc Used %u centres with %u leafs each: %u nodes\np %u %u\nx\n", k, m, n, k, m);
+    for (i = 0; i < n; i++)
+        fprintf(fp, "%u 0\n", xs[i]);
+    for (i = 0; (i < n) && (ys[i] == i + 1); i++);
+    if (i < n)
+    {
+        fputs("y\n", fp);
+        for (i = 0; i < n; i++)
+            fprintf(fp, "%u 0\n", ys[i]);
+    }
+    fclose(fp);
+    return 1;
+}
+
+/** Write instance (xs, ys) as a request line of the solver service to fp, with id and algorithms alg
+ * 261018 Created
+ */
+void genWriteReq(FILE *fp, const char *id, const char *alg, const unsigned *xs, const unsigned *ys)
+{
+    unsigned i;
+
+    fprintf(fp, "solve %s %s %u %u y", id, alg, k, m);
+    for (i = 0; i < n; i++)
+        fprintf(fp, " %u", xs[i]);
+    for (i = 0; i < n; i++)
+        fprintf(fp, " %u", ys[i]);
+    fputc('\n', fp);
+}
@@ -7,6 +7,7 @@
  */
 
 #define EOC             (unsigned)-1    // End Of Cycle
+#define TAB_MISS        UINT_MAX        // tabSolve(): the table in use does not hold W
 //#define OK              (unsigned)-1    //
 #define LINE_LEN        50              // Length of a line from . file
 // Console text colors
@@ -23,126 +24,313 @@
 #define BEING_USED      (IGNORE_C | (1 << IGNORE_C))    // The number of the centre is being swapped
 #define CORRECT         (IGNORE_C | (2 << IGNORE_C))    // Swap centre with leaf if necessary
 #define SORTED          (IGNORE_C | (4 << IGNORE_C))    // Centre with leafs OK
+// Anomalies found while solving an instance
+#define ERR_NONE        0
+#define ERR_W_RANGE     1       // The moves out of or into a star are not m+1
+#define ERR_MCL_ITER    2       // getMinCycleLen() does not end
+#define ERR_SP_LEN      3       // wShortestPaths() finds no path of length < n
+#define ERR_DC_LEN      4       // delCycle() finds no cycle of length < n
+#define ERR_NO_CYCLE    5       // getDecomp() cannot remove any cycle
+#define ERR_X_UNSET     6       // setW() is called before x is set
+#define ERR_NO_DEST     7       // A label of x is not in y
+#define ERR_NO_SWAP     8       // routeStages() finds no swap to do
+#define ERR_NO_LABEL    9       // routeCycles() finds no label for the next star of a cycle
+#define ERR_NO_MEM      10      // Out of memory
+#define ERR_SCHED_ORDER 11      // verifySched(): the stages of the schedule are not in order
+#define ERR_SCHED_CONFLICT 12   // verifySched(): a node is in 2 swaps of a stage
+#define ERR_SCHED_EDGE  13      // verifySched(): a swap is not on an edge of the star graph
+#define ERR_NOT_SORTED  14      // verifySched(): the schedule does not sort x0 to y
+#define ERR_SCHED_COUNT 15      // verifyRecorded(): depth, Ns or Nsb differ from the replay
+#define NERR            16      // #error codes
+#define GIVE_UP         (solveErr && !pauseOnErr)   // Give up on the instance after an anomaly, unless interactive
+//#define REF_2CYCLES           // Delete 2-cycles by the scalar reference del2cyclesRef(), to verify del2cycles()
+//#define REF_SHORT_CYCLES      // Delete 3- and 4-cycles by the walk of delCycles() instead of the bitset kernels
+//#define REF_RULES             // Apply ruleB(), ruleC() by their scans of W instead of by kernelize()
 
 #include <limits.h>
 #include <math.h>
+#include <stdarg.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+typedef unsigned short wgt_t;           // Entry of W, Wc: W(i,j) <= m+1 and np(i) <= max(m+1, k)
 
 // Function prototypes
 extern char swap(const unsigned i, const unsigned j);
-
-static void allocMem();
+extern void logCycle(const unsigned *c, const unsigned len, const char rev);
+extern void logContract(const unsigned a, const unsigned b, const unsigned c);
+unsigned tabSolve();
+unsigned decompRest(unsigned beta);
+
+char allocMem();
+static inline void incW(const unsigned gi, const unsigned gj);
+static inline void decW(const unsigned gi, const unsigned gj);
+void countW();
 static char finalize();
 static unsigned add(unsigned *v, unsigned *len, const unsigned num);
 void setW();
+static void setW16(const lab16 *xs, const lab16 *ys);
+static void setW32(const unsigned *xs, const unsigned *ys);
 void printW();
-
-unsigned k, m, n;                       // #centres, #leafs/centre, #nodes
-unsigned Ns, Nsb;
-unsigned depth;
-unsigned *x0, *x, *y;                   // Input vector x0, state vector x, output vector y
-unsigned **W, **Wc;                     // Move matrix
-unsigned *P;                            // Node cover
-unsigned *cycle, *ndist, *np;           // Store cycle, distance to node, #paths
-unsigned dbg;                           // dbg = 1 to debug the program, otherwise 0
-char     *c2use;                        // centres to use (in current stage)
+static char budgetOut();
+
+// Problem and solver state of this thread
+TLS unsigned k, m, n;                   // #centres, #leafs/centre, #nodes
+TLS unsigned Ns, Nsb;
+TLS unsigned depth;
+TLS unsigned long long wCost, wDepth;   // Weighted #swaps, weighted depth under the cost model (cost.c)
+TLS unsigned wStage, wStageMax;         // Stage of the last swap, cost of its most expensive swap
+TLS unsigned char labW;                 // #bytes/node label in x0, x, y: 2 or 4
+TLS void     *x0, *x, *y;               // Input vector x0, state vector x, output vector y (labW bytes/label)
+TLS wgt_t    **W, **Wc;                 // Move matrix
+TLS wgt_t    **WT;                      // Transpose of W: WT(j,i) = W(i,j); kept up to date by incW(), decW()
+TLS unsigned *P;                        // Node cover
+TLS unsigned *cycle;                    // Store cycle; k+1 entries, for a walk of delCycles()
+TLS wgt_t    *ndist, *np;               // Distance to node, #paths
+TLS unsigned long long *outB, *inB;     // Bitsets per node (kw words): out-, in-neighbours in W
+TLS unsigned long long *outMB, *inMB;   // Bitsets per node (kw words): out-, in-neighbours over marked edges of Wc
+TLS unsigned kw;                        // #64-bit words of a bitset of k nodes
+TLS unsigned *inDeg, *outDeg;           // #in-, #out-neighbours per node in W; kept up to date by incW(), decW()
+TLS unsigned *inW, *outW;               // Weight of the moves into, out of each node in W, without W(i,i)
+TLS unsigned wOff;                      // Weight of W without its diagonal: 0 if the graph is empty
+TLS unsigned *kWork;                    // Worklist of kernelize(): nodes that may have 1 in- or out-neighbour
+TLS char     *inWork;                   // inWork[i] = 1 if node i is in the worklist
+TLS unsigned dbg;                       // dbg = 1 to debug the program, otherwise 0
+TLS char     *c2use;                    // centres to use (in current stage)
+TLS char     solveErr;                  // First anomaly of the current instance: ERR_...
+TLS char     cycRec;                    // Log the cycles and contractions of getDecomp() (routeCycles())
+TLS unsigned long long budgetNs;        // Time budget of getDecomp() [ns]; 0: no budget
+TLS unsigned long long budgetOps;       // Operation budget of getDecomp() (see budgetOut()); 0: no budget
+TLS char     decompFull;                // 1 if the last getDecomp() ran with full effort, 0 if it hit its budget
+static TLS unsigned long long budgetT0, budgetN;
+char     pauseOnErr = 1;                // Show anomalies and pause to inspect them (interactive use)
 HANDLE   hConsole;
+const char *errName[NERR] = {"ok", "w_range", "mcl_iter", "sp_len", "dc_len", "no_cycle", "x_unset", "no_dest", "no_swap", "no_label", "no_mem",
+                              "sched_order", "sched_conflict", "sched_edge", "not_sorted", "sched_count"};
+static TLS arena memArena;              // Block with the solver buffers of this thread
+static TLS void   *passRes;             // Results of the parallel analysis passes
+static TLS size_t passResSize;
 
+#ifndef RS_BUILD_LIB
 /** Initialize variables
  * 170410 Created
+ * 261018 Not in the library
  */
 static void init()
 {
     getParams();    // Get k, m
     initParams();   // Set n
-    allocMem();
+    if (!allocMem())
+        exit(EXIT_FAILURE);
 
-    srand(time(NULL));
+    srnd(time(NULL));
     hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 }
+#endif // RS_BUILD_LIB
+
+/** Register anomaly code in solveErr. In interactive use, the message fmt and W are shown
+ * and the solver pauses before it continues.
+ * Returns non-zero if the solver should give up on the instance.
+ * 261018 Created
+ */
+static char anomaly(const char code, const char *fmt, ...)
+{
+    va_list args;
+
+    if (solveErr == ERR_NONE)
+        solveErr = code;                // Keep the first anomaly
+    if (!pauseOnErr)
+        return 1;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printW();
+    getchar();
+    return 0;
+}
+
+/** Set up the solver for a problem with kk centres and mm leafs/centre
+ * Returns 0 if the problem is too large or the memory could not be allocated
+ * 261018 Created
+ */
+char setProblem(const unsigned kk, const unsigned mm)
+{
+    if ( (kk == 0) || (mm == 0) || (kk > LAB16_MAX) || (mm >= LAB16_MAX)
+            || ((unsigned long long)kk * (mm + 1) >= UINT_MAX) )
+        return 0;                   // W, np are stored in 16 bits; labels in 32 bits
+    k = kk;
+    m = mm;
+    initParams();
+    return allocMem();
+}
 
 /** Set x to initial state x0
  * 170530 Created
  */
 void setX()
 {
-    memcpy(x, x0, n * sizeof(unsigned));    // Set the state equal to the initial state
+    memcpy(x, x0, n * labW);                // Set the state equal to the initial state
+}
+
+/** Get #bytes of the solver buffers of the (k, m) problem
+ * 261018 Created
+ */
+static size_t memSize()
+{
+    return 3 * ALIGN_UP(n * labW)                   // x0, x, y
+         + 3 * ALIGN_UP(k * sizeof(wgt_t*))         // Rows of W, Wc, WT
+         + 3 * k * ALIGN_UP(k * sizeof(wgt_t))      // W, Wc, WT
+         + 2 * ALIGN_UP(k * sizeof(wgt_t))          // ndist, np
+         + ALIGN_UP((k + 1) * sizeof(unsigned))     // cycle
+         + ALIGN_UP(k * sizeof(unsigned))           // P
+         + 5 * ALIGN_UP(k * sizeof(unsigned))       // inDeg, outDeg, inW, outW, kWork
+         + ALIGN_UP(k * sizeof(char))               // inWork
+         + 4 * ALIGN_UP((size_t)k * ((k + 63) / 64) * sizeof(unsigned long long))  // outB, inB, outMB, inMB
+         + ALIGN_UP(k * sizeof(char));              // c2use
 }
 
-static void allocMem()
+/** Allocate the solver buffers of the (k, m) problem out of the arena of this thread.
+ * The arena is reused if it is large enough.
+ * Returns 0 if failed
+ * 261018 Carve all buffers out of one block
+ */
+char allocMem()
 {
     unsigned i;
+    const size_t row = k * sizeof(wgt_t);
 
-    // Allocate memory
-    x0 = (unsigned*)malloc(n * sizeof(unsigned));
-    if (x0 == NULL)
-    {
-        puts("Error allocating mem x0");
-        exit(EXIT_FAILURE);
-    }
-    x = (unsigned*)malloc(n * sizeof(unsigned));
-    if (x == NULL)
+    if (!arenaReserve(&memArena, memSize(), hugePages))
     {
-        puts("Error allocating mem x");
-        exit(EXIT_FAILURE);
-    }
-    y = (unsigned*)malloc(n * sizeof(unsigned));
-    if (y == NULL)
-    {
-        puts("Error allocating mem y");
-        exit(EXIT_FAILURE);
+        puts("Error allocating solver mem");
+        return 0;
     }
-    W = (unsigned**)malloc(k * sizeof(unsigned*));
-    if (W == NULL)
+    x0    = arenaAlloc(&memArena, n * labW);
+    x     = arenaAlloc(&memArena, n * labW);
+    y     = arenaAlloc(&memArena, n * labW);
+    W     = (wgt_t**)arenaAlloc(&memArena, k * sizeof(wgt_t*));
+    Wc    = (wgt_t**)arenaAlloc(&memArena, k * sizeof(wgt_t*));
+    WT    = (wgt_t**)arenaAlloc(&memArena, k * sizeof(wgt_t*));
+    for (i = 0; i < k; i++)
     {
-        puts("Error allocating mem W");
-        exit(EXIT_FAILURE);
+        W[i]  = (wgt_t*)arenaAlloc(&memArena, row);
+        Wc[i] = (wgt_t*)arenaAlloc(&memArena, row);
+        WT[i] = (wgt_t*)arenaAlloc(&memArena, row);
     }
-    for (i = 0; i < k; i++)
+    ndist = (wgt_t*)arenaAlloc(&memArena, k * sizeof(wgt_t));
+    np    = (wgt_t*)arenaAlloc(&memArena, k * sizeof(wgt_t));
+    cycle = (unsigned*)arenaAlloc(&memArena, (k + 1) * sizeof(unsigned));
+    P     = (unsigned*)arenaAlloc(&memArena, k * sizeof(unsigned));
+    inDeg  = (unsigned*)arenaAlloc(&memArena, k * sizeof(unsigned));
+    outDeg = (unsigned*)arenaAlloc(&memArena, k * sizeof(unsigned));
+    inW    = (unsigned*)arenaAlloc(&memArena, k * sizeof(unsigned));
+    outW   = (unsigned*)arenaAlloc(&memArena, k * sizeof(unsigned));
+    kWork  = (unsigned*)arenaAlloc(&memArena, k * sizeof(unsigned));
+    inWork = (char*)arenaAlloc(&memArena, k * sizeof(char));
+    kw    = (k + 63) / 64;
+    outB  = (unsigned long long*)arenaAlloc(&memArena, (size_t)k * kw * sizeof(unsigned long long));
+    inB   = (unsigned long long*)arenaAlloc(&memArena, (size_t)k * kw * sizeof(unsigned long long));
+    outMB = (unsigned long long*)arenaAlloc(&memArena, (size_t)k * kw * sizeof(unsigned long long));
+    inMB  = (unsigned long long*)arenaAlloc(&memArena, (size_t)k * kw * sizeof(unsigned long long));
+    c2use = (char*)arenaAlloc(&memArena, k * sizeof(char));
+
+    return 1;
+}
+
+/** Release the solver buffers of this thread
+ * 261018 Created
+ */
+void freeMem()
+{
+    arenaFree(&memArena);
+    free(passRes);
+    passRes = NULL;
+    passResSize = 0;
+    x0 = x = y = NULL;
+    W  = Wc = WT = NULL;
+    ndist = np = NULL;
+    cycle = P = NULL;
+    outB  = inB = outMB = inMB = NULL;
+    inDeg = outDeg = kWork = NULL;
+    inW   = outW = NULL;
+    inWork = NULL;
+    c2use = NULL;
+}
+
+/** Add 1 move from centre gi to centre gj to W and WT, and to the degrees and weights of the graph
+ * 261018 Created
+ * 261018 Update inDeg, outDeg
+ * 261018 Update inW, outW, wOff
+ */
+static inline void incW(const unsigned gi, const unsigned gj)
+{
+    if (gi != gj)
     {
-        W[i] = (unsigned*)malloc(k * sizeof(unsigned));
-        if (W[i] == NULL)
+        if (W[gi][gj] == 0)
         {
-            puts("Error allocating mem W[]");
-            exit(EXIT_FAILURE);
+            outDeg[gi]++;
+            inDeg[gj]++;
         }
+        outW[gi]++;
+        inW[gj]++;
+        wOff++;
     }
-    Wc = (unsigned**)malloc(k * sizeof(unsigned*));
-    if (Wc == NULL)
-    {
-        puts("Error allocating mem Wc");
-        exit(EXIT_FAILURE);
-    }
-    for (i = 0; i < k; i++)
+    W[gi][gj]++;
+    WT[gj][gi]++;
+}
+
+/** Remove 1 move from centre gi to centre gj from W and WT, and from the degrees and weights of the graph
+ * 261018 Created
+ * 261018 Update inDeg, outDeg
+ * 261018 Update inW, outW, wOff
+ */
+static inline void decW(const unsigned gi, const unsigned gj)
+{
+    W[gi][gj]--;
+    WT[gj][gi]--;
+    if (gi != gj)
     {
-        Wc[i] = (unsigned*)malloc(k * sizeof(unsigned));
-        if (Wc[i] == NULL)
+        if (W[gi][gj] == 0)
         {
-            puts("Error allocating mem Wc[]");
-            exit(EXIT_FAILURE);
+            outDeg[gi]--;
+            inDeg[gj]--;
         }
+        outW[gi]--;
+        inW[gj]--;
+        wOff--;
     }
-    ndist = (unsigned*)malloc(k * sizeof(unsigned));
-    if (ndist == NULL)
-        exit(EXIT_FAILURE);
-    np    = (unsigned*)malloc(k * sizeof(unsigned));
-    if (np == NULL)
-        exit(EXIT_FAILURE);
-    cycle = (unsigned*)malloc(k * sizeof(unsigned));
-    if (cycle == NULL)
-        exit(EXIT_FAILURE);
-    P     = (unsigned*)malloc(k * sizeof(unsigned));
-    if (P == NULL)
-    {
-        puts("Error allocating P");
-        exit(EXIT_FAILURE);
-    }
-    c2use = (char*)malloc(k * sizeof(char));
-    if (c2use == NULL)
-        exit(EXIT_FAILURE);
+}
+
+/** Count the degrees and weights of the graph of W (inDeg, outDeg, inW, outW, wOff) again, after W
+ * was set other than by incW(), decW()
+ * 261018 Created
+ * 261018 Count the weights
+ */
+void countW()
+{
+    unsigned gi, gj;
+
+    memset(inDeg, 0, k * sizeof(unsigned));
+    memset(outDeg, 0, k * sizeof(unsigned));
+    memset(inW, 0, k * sizeof(unsigned));
+    memset(outW, 0, k * sizeof(unsigned));
+    wOff = 0;
+    for (gi = 0; gi < k; gi++)
+        for (gj = 0; gj < k; gj++)
+            if ( (gj != gi) && W[gi][gj] )
+            {
+                outDeg[gi]++;
+                inDeg[gj]++;
+                outW[gi] += W[gi][gj];
+                inW[gj]  += W[gi][gj];
+                wOff     += W[gi][gj];
+            }
 }
 
 /** Reset the variables for this round (depth, Ns, Nsb)
  * 170520 Created
+ * 261018 Reset the weighted cost and depth
  */
 void newRound()
 {
@@ -152,6 +340,8 @@ void newRound()
     depth = 0;          //
     Ns    = 0;          // No swaps done
     Nsb   = 0;          // No expensive swaps done with cost b
+    wCost = wDepth = 0;
+    wStage = wStageMax = 0;
     dbg   = 0;
 
     memset(c2use, 1, k * sizeof(char));
@@ -181,6 +371,7 @@ static void newStage()
             c2use[gj] = CORRECT;
     }
     depth++;
+    TR_STAGE();
     //swapDone = 0;
     if (dbg)
     {
@@ -206,7 +397,7 @@ static char finalize()
         if (c2use[i] == CORRECT)    // If the right number should be brought from a leaf to the centre
         {
             for (l = 1; l <= m; l++)
-                if (x[i*(m+1) + l] == i*(m+1))
+                if (LAB(x, i*(m+1) + l) == i*(m+1))
                 {
                     if (swap(i*(m+1), i*(m+1) + l)) // If the swap with this leaf succeeded
                         c2use[i] = SORTED; // This node group is sorted now
@@ -225,25 +416,55 @@ static char finalize()
 
 /** Check if nodes gi, gj are in >= 1 cycle
  * 170607 Created
+ * 261018 Update WT; log the 2-cycles
+ * 261018 Update the degrees of the graph
+ * 261018 Update the weights of the graph
  */
 static unsigned handleCycle(const unsigned gi, const unsigned gj)
 {
-    unsigned cnt;
+    unsigned cnt, c, pair[2];
 
     if (W[gi][gj])
     {
-        cnt = (unsigned)fmin((float)W[gi][gj], (float)W[gj][gi]);   // So many efficient swaps are possible over edge (i,j)
-        W[gi][gj] -= cnt;
-        W[gj][gi] -= cnt;
+        cnt = W[gi][gj] < W[gj][gi] ? W[gi][gj] : W[gj][gi];   // So many efficient swaps are possible over edge (i,j)
+        if (cycRec)
+        {
+            pair[0] = gi;
+            pair[1] = gj;
+            for (c = 0; c < cnt; c++)
+                logCycle(pair, 2, 0);
+        }
+        W[gi][gj]  -= cnt;
+        W[gj][gi]  -= cnt;
+        WT[gj][gi] -= cnt;
+        WT[gi][gj] -= cnt;
+        if (cnt == 0)
+            return 0;
+        if (W[gi][gj] == 0)
+        {
+            outDeg[gi]--;
+            inDeg[gj]--;
+        }
+        if (W[gj][gi] == 0)
+        {
+            outDeg[gj]--;
+            inDeg[gi]--;
+        }
+        outW[gi] -= cnt;
+        inW[gj]  -= cnt;
+        outW[gj] -= cnt;
+        inW[gi]  -= cnt;
+        wOff     -= 2 * cnt;
         return cnt;
     }
     return 0;
 }
 
-/** Delete 2-cycles from W & count #2-cycles
+/** Delete 2-cycles from W & count #2-cycles, pair by pair: the scalar reference of del2cycles()
  * 170701 Created
+ * 261018 Renamed from del2cycles()
  */
-unsigned del2cycles()
+unsigned del2cyclesRef()
 {
     unsigned gi, gj, cnt = 0;
 
@@ -253,185 +474,383 @@ unsigned del2cycles()
     return cnt;                         // Return #2-cycles
 }
 
+/** Delete 2-cycles from W & count #2-cycles.
+ * Row gi of W and row gi of WT hold both directions of the edges of gi, so subtracting
+ * min(W, WT) from W and from WT is element-wise over contiguous rows: W' = W -sat WT, WT' = WT -sat W.
+ * Each 2-cycle is counted in 2 rows. The diagonal is restored.
+ * Rows gi of W and WT are final once done, so the degrees and weights of node gi are set from them
+ * in the same pass: the zero entries are counted, and the weight of the row drops by its 2-cycles.
+ * 170701 Created
+ * 261018 Element-wise over W and its transpose WT, 8 entries/SSE2 instruction
+ * 261018 Update the degrees of the graph
+ * 261018 Update the weights of the graph
+ */
+unsigned del2cycles()
+{
+    unsigned gi, gj, cnt = 0, c0, zw, zwt;
+    wgt_t *w, *wt, d, c;
+#ifdef USE_SSE2
+    __m128i a, b, acc;
+    const __m128i zero = _mm_setzero_si128();
+    unsigned sum[4];
+#endif // USE_SSE2
+
+#ifdef REF_2CYCLES
+    return del2cyclesRef();
+#endif // REF_2CYCLES
+    if (cycRec)
+        return del2cyclesRef();         // Log the 2-cycles pair by pair
+    for (gi = 0; gi < k; gi++)
+    {
+        w   = W[gi];
+        wt  = WT[gi];
+        d   = w[gi];
+        c0  = cnt;
+        zw  = zwt = 0;                  // #zero entries in the rows
+        gj  = 0;
+#ifdef USE_SSE2
+        acc = zero;
+        for (; gj + 8 <= k; gj += 8)
+        {
+            a = _mm_load_si128((const __m128i*)&w[gj]); // Rows are ARENA_ALIGN aligned
+            b = _mm_load_si128((const __m128i*)&wt[gj]);
+            _mm_store_si128((__m128i*)&w[gj], _mm_subs_epu16(a, b));
+            _mm_store_si128((__m128i*)&wt[gj], _mm_subs_epu16(b, a));
+            zw  += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(a, b), zero)));
+            zwt += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(b, a), zero)));
+            a = _mm_sub_epi16(a, _mm_subs_epu16(a, b));  // min(W, WT)
+            acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_unpacklo_epi16(a, zero), _mm_unpackhi_epi16(a, zero)));
+        }
+        _mm_storeu_si128((__m128i*)sum, acc);
+        cnt += sum[0] + sum[1] + sum[2] + sum[3];
+        zw  /= 2;                       // 2 mask bits per entry
+        zwt /= 2;
+#endif // USE_SSE2
+        for (; gj < k; gj++)
+        {
+            c = w[gj] < wt[gj] ? w[gj] : wt[gj];
+            w[gj]  -= c;
+            wt[gj] -= c;
+            cnt    += c;
+            zw     += (w[gj] == 0);
+            zwt    += (wt[gj] == 0);
+        }
+        cnt  -= d;                      // W(i,i) = WT(i,i) is no 2-cycle
+        w[gi] = d;
+        wt[gi] = d;
+        outDeg[gi] = k - zw;            // The diagonal is counted as 0
+        inDeg[gi]  = k - zwt;
+        outW[gi]  -= cnt - c0;
+        inW[gi]   -= cnt - c0;
+        wOff      -= cnt - c0;
+    }
+    return cnt / 2;                     // Return #2-cycles
+}
+
 /** Check if W empty on non-diagonal entries
  * 170803 Created
+ * 261018 By the weight kept by incW(), decW(); W is checked for W(i,j) > m+1 by setW()
  */
 char emptyGraph()
 {
-    unsigned i, j;
+    return wOff == 0;
+}
 
-    for (i = 0; i < k; i++)
-        for (j = 0; j < k; j++)
+/** Get the length of a shortest cycle through node gs in Wm, using dist (kk entries) as scratch
+ * Returns UINT_MAX if gs has no outgoing edges, 0 if no cycle of length <= kk is found (anomaly)
+ * 261018 Created from getMinCycleLen(), to run it per node gs on any thread
+ */
+static unsigned minCycleLenFrom(wgt_t **Wm, const unsigned kk, const unsigned gs, wgt_t *dist)
+{
+    unsigned gi, gj, len, edgesOut;
+
+    OP_INC(OC_BFS);
+    memset(dist, 0, kk * sizeof(wgt_t));
+    for (len = 0; len <= kk; len++)         // Increase path length
+    {
+        for (gi = (len == 0) ? gs : 0; gi < kk; gi++)   // Keep walking until a cycle has been walked
         {
-            if (W[i][j] > m + 1)
+            if (dist[gi] != len)
+                continue;
+            OP_INC(OC_BFS_NODE);
+            OP_ADD(OC_BFS_SCAN, kk);
+            edgesOut = 0;
+            for (gj = 0; gj < kk; gj++)     // Look for nodes j which can be reached from node i
             {
-                printf("! W(%u,%u) > %2u\n", i+1, j+1, m+1);
-                printW();
-                getchar();
+                if ( (gj == gi) || (Wm[gi][gj] == 0) || dist[gj] )
+                    continue;
+                edgesOut = 1;               // Node i has >= 1 outgoing edges
+                // There exists >= 1 path from node i->j && the distance to node j is 0
+                if ( (len >= 1) && (gj == gs) ) // If a cycle has been walked
+                    return len + 1;
+                dist[gj] = len + 1;         // Set distance from node s->j
             }
-            if (i != j)
+            if (len == 0)
             {
-                if (W[i][j])
-                    return 0;
+                if (!edgesOut)              // If node i does not have outgoing edges
+                    return UINT_MAX;
+                break;
             }
-        }
-    return 1;
+        } // End for gi
+    }
+    return 0;
+}
+
+typedef struct
+{
+    wgt_t    **W;                           // Move matrix of the calling thread
+    const unsigned *outDeg;                 // Its #out-neighbours per node
+    unsigned k, n;
+    unsigned row;                           // Row of the edges of markJob()
+    unsigned *len;                          // Result per node
+    char     *flag;                         // Result per edge
+} passCtx;
+
+/** Get the result buffer of the parallel passes of this thread, of >= size bytes
+ * Returns NULL if failed
+ * 261018 Created
+ */
+static void *getPassRes(const size_t size)
+{
+    if (passResSize < size)
+    {
+        free(passRes);
+        passResSize = 0;
+        if ((passRes = malloc(size)) == NULL)
+            return NULL;
+        passResSize = size;
+    }
+    return passRes;
+}
+
+/** Pool job: res[gs] = length of a shortest cycle through node gs
+ * 261018 Created
+ * 261018 UINT_MAX without a BFS if gs has no out-neighbours
+ */
+static void mclJob(void *ctx, const unsigned gs, const unsigned tid)
+{
+    passCtx *c = (passCtx*)ctx;
+    wgt_t *dist;
+
+    if (c->outDeg[gs] == 0)
+    {
+        c->len[gs] = UINT_MAX;
+        return;
+    }
+    dist = (wgt_t*)parScratch(tid, c->k * sizeof(wgt_t));
+    c->len[gs] = dist ? minCycleLenFrom(c->W, c->k, gs, dist) : 0;
 }
 
 /** Get the minimum cycle length
  * 170610 Created
  * 170612 Works correctly
+ * 261018 Run the BFS per start node on the thread pool if k >= PAR_MIN_K
+ * 261018 Skip the nodes without out-neighbours (outDeg)
  */
 static unsigned getMinCycleLen()
 {
-    unsigned gs, gi, gj, len, done, Niter = 0;  // Start node s
-    unsigned edgesOut, lmin = UINT_MAX;
+    unsigned gs, len, lmin = UINT_MAX;      // Start node s
+    const char par = (parN > 1) && (k >= PAR_MIN_K);
+    passCtx c;
 
     if (W[0][0] > m + 1)                        // If W is not set yet
     {
         puts("gMCL:\tW set");
         setW();
     }
-    for (gs = 0; gs < k; gs++)
+    if ( par && ((c.len = (unsigned*)getPassRes(k * sizeof(unsigned))) != NULL) )
     {
-        memset(ndist, 0, k * sizeof(unsigned));
-        len = 0;
-        done = 0;
-        while (!done)
-        {
-            if (Niter == k*k)
-            {
-                printW();
-                puts("! gMCL:\tCheck this!");
-                getchar();
-            }
-            Niter++;
-            for (gi = 0; gi < k; gi++)          // Keep walking until a cycle has been walked
-            {
-                if (len == 0)
-                    gi = gs;
-                if (ndist[gi] == len)
-                {
-                    edgesOut = 0;
-                    for (gj = 0; gj < k; gj++)  // Look for nodes j which can be reached from node i
-                    {
-                        if ( (gj == gi) || (W[gi][gj] == 0) || ndist[gj] )
-                            continue;
-                        edgesOut = 1;           // Node i has >= 1 outgoing edges
-                        // There exists >= 1 path from node i->j && the distance to node j is 0
-                        if ( (len >= 1) && (gj == gs) ) // If a cycle has been walked
-                        {
-                            if (len + 1 < lmin)
-                                lmin = len + 1; // Track minimum cycle length
-                            gi = k;         // Break outer loop gi; search cycles for the next node s
-                            done = 1;       // Min length of cycle found for node s; continue with the next node s
-                            break;
-                        }
-                        ndist[gj] = len + 1;// Set distance from node s->j
-                    }
-                    if (len == 0)
-                    {
-                        if (!edgesOut)      // If node i does not have outgoing edges
-                            done = 1;
-                        break;
-                    }
-                }
-            } // End for gi
-            len++;                          // Increase path length
-        }
+        c.W      = W;
+        c.outDeg = outDeg;
+        c.k      = k;
+        parFor(k, mclJob, &c);
+    }
+    else
+        c.len = NULL;
+    for (gs = 0; gs < k; gs++)              // Reduce in the order of gs
+    {
+        if (c.len)
+            len = c.len[gs];
+        else
+            len = outDeg[gs] ? minCycleLenFrom(W, k, gs, ndist) : UINT_MAX;
+        if ( (len == 0) && anomaly(ERR_MCL_ITER, "! gMCL:\tCheck this!\n") )
+            return lmin;
+        if ( len && (len < lmin) )
+            lmin = len;                     // Track minimum cycle length
     }
 
     return lmin;
 }
 
-/** Return length of shortest path from pi --> pj iff there are <= Wij shortest paths, otherwise return 0
- * 170802 Created
+/** Return length of shortest path from pi --> pj in Wm iff there are <= Wm(pj,pi) shortest paths, otherwise return 0.
+ * dist, npaths (kk entries) are scratch. If cyc != NULL, a shortest cycle is stored in cyc.
+ * *err is set if no path of length < nn is found.
+ * 261018 Created from wShortestPaths(), to run it per edge on any thread
  */
-unsigned wShortestPaths(const unsigned pi, const unsigned pj)
+static unsigned shortestPaths(wgt_t **Wm, const unsigned kk, const unsigned nn, const unsigned pi, const unsigned pj,
+                              wgt_t *dist, wgt_t *npaths, unsigned *cyc, char *err)
 {
     unsigned len = 0, plen;
     unsigned p1, p2;
 
-    memset(ndist, 0, k * sizeof(unsigned));
-    memset(np, 0, k * sizeof(unsigned));
-    memset(cycle, UINT_MAX, k * sizeof(unsigned));
+    OP_INC(OC_BFS);
+    memset(dist, 0, kk * sizeof(wgt_t));
+    memset(npaths, 0, kk * sizeof(wgt_t));
 
-    while (np[pj] == 0)                     // While no shortest path is found
+    while (npaths[pj] == 0)                 // While no shortest path is found
     {
-        for (p1 = 0; p1 < k; p1++)              // Keep walking until a cycle has been walked
+        for (p1 = 0; p1 < kk; p1++)             // Keep walking until a cycle has been walked
         {
             if (len == 0)
             {
                 p1 = pi;
-                np[pi] = W[pj][pi];
+                npaths[pi] = Wm[pj][pi];
             }
-            if (ndist[p1] == len)
+            if (dist[p1] == len)
             {
-                for (p2 = 0; p2 < k; p2++)      // Look for nodes p2 which can be reached from node p1
+                OP_INC(OC_BFS_NODE);
+                OP_ADD(OC_BFS_SCAN, kk);
+                for (p2 = 0; p2 < kk; p2++)     // Look for nodes p2 which can be reached from node p1
                 {
-                    if ( (p2 == p1) || (W[p1][p2] == 0) )
+                    if ( (p2 == p1) || (Wm[p1][p2] == 0) )
                         continue;
                     // There exists >= 1 path from node p1 -> p2
                     if ( (len >= 1) && (p2 == pj) ) // If a shortest path has been found
                     {
-                        np[p2] += (unsigned)fminf((float)np[p1], (float)W[p1][p2]);
+                        npaths[p2] += (unsigned)fminf((float)npaths[p1], (float)Wm[p1][p2]);
                     }
-                    else if ( (ndist[p2] == 0) || (ndist[p2] == len + 1) )
+                    else if ( (dist[p2] == 0) || (dist[p2] == len + 1) )
                     {
-                        np[p2] += (unsigned)fminf((float)np[p1], (float)W[p1][p2]);
-                        ndist[p2] = len + 1;    // Set distance from node pi -> p2
+                        npaths[p2] += (unsigned)fminf((float)npaths[p1], (float)Wm[p1][p2]);
+                        dist[p2] = len + 1;     // Set distance from node pi -> p2
                     }
                 }
                 if (len == 0)
                     break;
             }
         } // End for p1
-        if (len >= n)
+        if (len >= nn)
         {
-            printW();
-            printf("! oSP: len: %u/%u\n", len, n);
-            getchar();
+            *err = 1;
+            return 0;
         }
         len++;                                  // Increase path length
     } // End while npj==0
 
-    // Backtrack a shortest cycle & store the cycle
-    cycle[0] = pi;
-    cycle[len] = pj;
-    p2 = pj;
     plen = len;
-    len--;
-    for (p1 = 0; len && (p1 < k) && (cycle[len] == EOC); )
+    if (cyc != NULL)
     {
-        if ( (p1 != p2) && W[p1][p2] && (ndist[p1] == len) )
+        // Backtrack a shortest cycle & store the cycle
+        memset(cyc, UINT_MAX, kk * sizeof(unsigned));
+        cyc[0] = pi;
+        cyc[len] = pj;
+        p2 = pj;
+        len--;
+        for (p1 = 0; len && (p1 < kk) && (cyc[len] == EOC); )
         {
-            cycle[len--] = p1;
-            p2 = p1;
-            p1 = 0;
+            if ( (p1 != p2) && Wm[p1][p2] && (dist[p1] == len) )
+            {
+                cyc[len--] = p1;
+                p2 = p1;
+                p1 = 0;
+            }
+            else
+                p1++;
         }
-        else
-            p1++;
     }
 
-    if (np[pj] <= np[pi])           // If <= Wij shortest path from pi->pj
+    if (npaths[pj] <= npaths[pi])   // If <= Wij shortest path from pi->pj
         return plen;                // Return length of path
     else
         return 0;                   // Multiple shortest paths from pi->pj
 }
 
+/** Return length of shortest path from pi --> pj iff there are <= Wij shortest paths, otherwise return 0
+ * 170802 Created
+ * 261018 Use shortestPaths()
+ */
+unsigned wShortestPaths(const unsigned pi, const unsigned pj)
+{
+    unsigned len;
+    char err = 0;
+
+    len = shortestPaths(W, k, n, pi, pj, ndist, np, cycle, &err);
+    if (err)
+        anomaly(ERR_SP_LEN, "! oSP: no path %u -> %u of length < %u\n", pi+1, pj+1, n);
+    return len;
+}
+
+/** Pool job: for edge (row, pj), flag[pj] = 1 if wShortestPaths(pj, row) != 0, 2 if it finds no path
+ * 261018 Created
+ * 261018 Per edge of 1 row
+ */
+static void markJob(void *ctx, const unsigned pj, const unsigned tid)
+{
+    passCtx *c = (passCtx*)ctx;
+    const unsigned pi = c->row;
+    wgt_t *dist;
+    char err = 0;
+
+    c->flag[pj] = 0;
+    if ( (pj == pi) || (c->W[pi][pj] == 0) )
+        return;
+    if ((dist = (wgt_t*)parScratch(tid, 2 * ALIGN_UP(c->k * sizeof(wgt_t)))) == NULL)
+        return;
+    if (shortestPaths(c->W, c->k, c->n, pj, pi, dist, dist + ALIGN_UP(c->k * sizeof(wgt_t)) / sizeof(wgt_t), NULL, &err))
+        c->flag[pj] = 1;
+    else if (err)
+        c->flag[pj] = 2;
+}
+
+/** Mark the edges (pi, pj) in Wc for which the shortest paths from pj -> pi are <= W(pi,pj)
+ * 261018 Created from getDecomp(); run per edge on the thread pool if k >= PAR_MIN_K
+ * 261018 Stop when the budget runs out (sequential run)
+ * 261018 Test the budget per row on the thread pool too
+ */
+static void markWc()
+{
+    unsigned pi, pj;
+    passCtx c;
+
+    if ( (parN > 1) && (k >= PAR_MIN_K) && ((c.flag = (char*)getPassRes(k)) != NULL) )
+    {
+        c.W = W;
+        c.k = k;
+        c.n = n;
+        for (pi = 0; (pi < k) && !budgetOut(); pi++)
+        {
+            c.row = pi;
+            parFor(k, markJob, &c);
+            for (pj = 0; pj < k; pj++)      // Reduce in the order of the edges
+            {
+                if (c.flag[pj] == 1)
+                    Wc[pi][pj] = 1;
+                else if (c.flag[pj] == 2)
+                    anomaly(ERR_SP_LEN, "! oSP: no path %u -> %u of length < %u\n", pj + 1, pi + 1, n);
+            }
+        }
+        return;
+    }
+    for (pi = 0; (pi < k) && !budgetOut(); pi++)
+    {
+        for (pj = 0; pj < k; pj++)
+        {
+            if ( (pj != pi) && W[pi][pj] && wShortestPaths(pj, pi) )
+            {
+                Wc[pi][pj] = 1;
+            }
+        }
+    }
+}
+
 /** Get #outgoing edges of centre gi
  * NOTE: W should be set in advance
  * 170607 Created
+ * 261018 Kept by incW(), decW()
  */
-static unsigned getEDegOut(const unsigned gi)
+static inline unsigned getEDegOut(const unsigned gi)
 {
-    unsigned gj, deg = 0;
-
-    for (gj = 0; gj < k; gj++)
-        if ( (gj != gi) && (W[gi][gj]) )
-            deg++;   // #outgoing edges
-
-    return deg;
+    return outDeg[gi];
 }
 
 /** Delete a cycle under certain conditions (cond)
@@ -457,8 +876,9 @@ static unsigned delCycle(const unsigned gs, const unsigned lmin, const char cond
     {
         if ( (g2 == gs) || (W[gs][g2] == 0) )
             continue;
-        memset(ndist, 0, k * sizeof(unsigned));
-        memset(np, 0, k * sizeof(unsigned));
+        OP_INC(OC_BFS);
+        memset(ndist, 0, k * sizeof(wgt_t));
+        memset(np, 0, k * sizeof(wgt_t));
         ndist[g2] = 1;                          // Check edge (gs,g2)
         len = 1;
         cnt = 0;                                // Reset cycle counter
@@ -473,6 +893,8 @@ static unsigned delCycle(const unsigned gs, const unsigned lmin, const char cond
                 }
                 if (ndist[gi] == len)
                 {
+                    OP_INC(OC_BFS_NODE);
+                    OP_ADD(OC_BFS_SCAN, k);
                     for (gj = 0; gj < k; gj++)  // Look for nodes j which can be reached from node i
                     {
                         if ( (gj == gi) || (W[gi][gj] == 0) )
@@ -501,12 +923,8 @@ static unsigned delCycle(const unsigned gs, const unsigned lmin, const char cond
                         break;
                 }
             } // End for gi
-            if (len >= n)
-            {
-                printW();
-                printf("! dC: len: %u/%u\n", len, n);
-                getchar();
-            }
+            if ( (len >= n) && anomaly(ERR_DC_LEN, "! dC: len: %u/%u\n", len, n) )
+                return 0;
             len++;                              // Increase path lengths
         } // End while cnt==0
 
@@ -534,7 +952,7 @@ static unsigned delCycle(const unsigned gs, const unsigned lmin, const char cond
                     if (dbg)
                         printf("%*u <- ", Nd, gj+1);
                     cycle[Ci++] = gj;           // Store nodes in cycle (in opposite direction)
-                    W[gi][gj]--;                // Remove edge from cycle
+                    decW(gi, gj);               // Remove edge from cycle
                     len--;
                     if (len == 0)
                         break;
@@ -546,155 +964,390 @@ static unsigned delCycle(const unsigned gs, const unsigned lmin, const char cond
                 printf("%*u\n", Nd, gi+1);
             len = cnt;                          // Restore cycle length
             cycle[Ci++] = gi;                   // Store nodes in cycle (in opposite direction)
-            W[gs][gi]--;                        // Remove last edge from cycle
+            decW(gs, gi);                       // Remove last edge from cycle
+            if (cycRec)
+                logCycle(cycle, Ci, 1);
             return 1;                           // +1 cycle found & deleted
         }
     }
     return 0;                                   // No cycle deleted
 }
 
-/** Delete cycles of length [len] from W
- * 170803 Created
+#define BIT(b, j)       (((b)[(j) >> 6] >> ((j) & 63)) & 1)
+#define CLR_BIT(b, j)   ((b)[(j) >> 6] &= ~(1ULL << ((j) & 63)))
+
+#ifndef REF_SHORT_CYCLES
+/** Set bitset b to the nonzero entries of row r of k entries, without entry skip
+ * 261018 Created
  */
-unsigned delCycles(const unsigned len)
+static void rowBits(const wgt_t *r, const unsigned skip, unsigned long long *b)
 {
-    unsigned i, gi, pj, gs, ci, cnt;
-    unsigned Nc = 0;                        // #cycles removed
+    unsigned j = 0;
+#ifdef USE_SSE2
+    const __m128i z = _mm_setzero_si128();
+    __m128i lo, hi;
+#endif // USE_SSE2
+
+    memset(b, 0, kw * sizeof(unsigned long long));
+#ifdef USE_SSE2
+    for (; j + 16 <= k; j += 16)                // 16 entries -> 16 bits
+    {
+        lo = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)&r[j]), z);
+        hi = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)&r[j+8]), z);
+        b[j >> 6] |= (unsigned long long)(~_mm_movemask_epi8(_mm_packs_epi16(lo, hi)) & 0xFFFF) << (j & 63);
+    }
+#endif // USE_SSE2
+    for (; j < k; j++)
+        if (r[j])
+            b[j >> 6] |= 1ULL << (j & 63);
+    CLR_BIT(b, skip);
+}
 
-    if (len == 2)
+/** Set the bitsets of the edges of W and of the marked edges of Wc
+ * 261018 Created
+ */
+static void setBits()
+{
+    unsigned i, j, w;
+    unsigned long long v;
+
+    memset(inMB, 0, (size_t)k * kw * sizeof(unsigned long long));
+    for (i = 0; i < k; i++)
     {
-        // Delete 2-cycles
-        for (gi = 0; gi < k; gi++)
-            for (pj = gi + 1; pj < k; pj++)
-                if ((ci = handleCycle(gi, pj))) // If there is >= 1 2-cycle => remove from W
-                    Nc += ci;               // Count #cycles removed
+        rowBits(W[i], i, &outB[i * kw]);
+        rowBits(WT[i], i, &inB[i * kw]);
+        rowBits(Wc[i], i, &outMB[i * kw]);
+        for (w = 0; w < kw; w++)                // Transpose the marks
+            for (v = outMB[i * kw + w]; v; v &= v - 1)
+            {
+                j = w * 64 + __builtin_ctzll(v);
+                inMB[j * kw + (i >> 6)] |= 1ULL << (i & 63);
+            }
+    }
+}
 
-        return Nc;                          // Ready
+/** Get the first node >= j in bitset b, or k if there is none
+ * 261018 Created
+ */
+static inline unsigned nextBit(const unsigned long long *b, const unsigned j)
+{
+    unsigned w = j >> 6;
+    unsigned long long v;
+
+    if (j >= k)
+        return k;
+    v = b[w] & (~0ULL << (j & 63));
+    while (!v)
+    {
+        if (++w >= kw)
+            return k;
+        v = b[w];
     }
+    return w * 64 + __builtin_ctzll(v);
+}
+
+/** Get the first node c in out(gb) and in(gs), not in {gs, ga, gb}, of which the edges gb -> c, c -> gs
+ * are both marked (both = 1) or at least 1 is marked (both = 0). Returns k if there is none.
+ * 261018 Created
+ */
+static unsigned closeBits(const unsigned gs, const unsigned ga, const unsigned gb, const char both)
+{
+    const unsigned long long *o = &outB[gb * kw], *in = &inB[gs * kw];
+    const unsigned long long *oM = &outMB[gb * kw], *inM = &inMB[gs * kw];
+    unsigned w, c;
+    unsigned long long v;
 
-    // Delete k-cycles, k >= 3
-    memset(np, 0, k * sizeof(unsigned));    // Set np[i] if node i visited
-    memset(cycle, UINT_MAX, k * sizeof(unsigned));
-    for (gs = 0; gs < k; gs++)
+    for (w = 0; w < kw; w++)
     {
-        np[gs] = 1;                         // Node gs is visited now
-        cycle[0] = gs;                      // Start walking from here
-        cycle[1] = EOC;
-        cnt = 0;
+        v = o[w] & in[w] & (both ? (oM[w] & inM[w]) : (oM[w] | inM[w]));
+        while (v)
+        {
+            c = w * 64 + __builtin_ctzll(v);
+            if ( (c != gs) && (c != ga) && (c != gb) )
+                return c;
+            v &= v - 1;
+        }
+    }
+    return k;
+}
+
+/** Remove cycle cyc of len nodes from W and Wc, and update the bitsets
+ * 261018 Created
+ */
+static void remBitsCycle(const unsigned *cyc, const unsigned len)
+{
+    unsigned p, u, v;
 
-        for (i = 1; i; )
+    for (p = 0; p < len; p++)
+    {
+        u = cyc[p];
+        v = cyc[(p + 1) % len];
+        decW(u, v);
+        if (W[u][v] == 0)
+        {
+            CLR_BIT(&outB[u * kw], v);
+            CLR_BIT(&inB[v * kw], u);
+        }
+        if ( Wc[u][v] && (--Wc[u][v] == 0) )
         {
-            gi = cycle[i] + 1;              // Search further from this node
+            CLR_BIT(&outMB[u * kw], v);
+            CLR_BIT(&inMB[v * kw], u);
+        }
+    }
+    if (cycRec)
+        logCycle(cyc, len, 0);
+    OP_CYC(len);
+}
+
+/** Delete the cycles of length 3 or 4 of which >= len-1 edges are marked in Wc, using bitsets:
+ * the 3-cycles through edge (gs, a) close over out(a) & in(gs), the 4-cycles through the path
+ * gs -> a -> b over out(b) & in(gs). The cycles are taken in the order of (gs, a, b, c).
+ * A removal cannot create a cycle or a mark, so the search goes on where it is.
+ * Returns the #cycles removed
+ * 261018 Created
+ * 261018 Stop when the budget runs out
+ */
+static unsigned delShortCycles(const unsigned len)
+{
+    unsigned gs, a, b, c, mk, cyc[4];
+    unsigned Nc = 0;
+    const unsigned long long *og;
 
-            for (; gi < k; gi++)            // Search next step
+    setBits();
+    for (gs = 0; (gs < k) && !budgetOut(); gs++)
+    {
+        og = &outB[gs * kw];
+        for (a = nextBit(og, 0); a < k; a = nextBit(og, a + 1))
+        {
+            if (len == 3)
             {
-                if (i == len)
-                {
-                    if (W[cycle[i-1]][gs])
-                        gi = gs;
-                    else
-                        break;
-                }
-                if ( (cycle[i-1] == gi) || ((i < len) && (cycle[i] == gi)) || !W[cycle[i-1]][gi] )
-                    continue;
-                // Take a step further in the walk
-                np[gi] = 1;                 // Node i visited
-                if (Wc[cycle[i-1]][gi])
-                {
-                    cnt++;                  // Count #edges (i,j) having a unique path from j->i
-                }
-                if ((ci = add(cycle, &i, gi)) != OK)  // If cycle walked (index i is increased by 1)
+                while ( BIT(og, a) && ((c = closeBits(gs, gs, a, !Wc[gs][a])) < k) )
                 {
-                    if (i < k)
-                        cycle[i] = EOC;     // Mark end of cycle
-                    if ( (i - ci == len) && (cnt >= len - 1) ) // If cycle has length len && if it can be removed
-                    {
-                        // OK, cycle can be deleted; do it
-                        for (pj = 1; pj < len; pj++)
-                        {
-                            W[cycle[pj-1]][cycle[pj]]--;
-                            if (Wc[cycle[pj-1]][cycle[pj]])
-                                Wc[cycle[pj-1]][cycle[pj]]--;
-                        }
-                        W[cycle[pj-1]][cycle[0]]--;
-                        if (Wc[cycle[pj-1]][cycle[0]])
-                            Wc[cycle[pj-1]][cycle[0]]--;
-                        Nc++;                       // +1 cycle removed
-                        // Avoid walking edges more often than possible; restart with gs = 0
-                        gs = -1;
-                        i = 1;              // Break loop i
-                        break;
-                    }
-                    // Take >= 1 step back
-                    i--;
-                    if (Wc[cycle[i-1]][cycle[i]])
-                    {
-                        cnt--;
-                    }
-                    cycle[i] = EOC;
-                    break;
+                    cyc[0] = gs;
+                    cyc[1] = a;
+                    cyc[2] = c;
+                    remBitsCycle(cyc, 3);
+                    Nc++;
                 }
-                else                            // If no cycle walked (index i is increased by 1)
+                continue;
+            }
+            for (b = nextBit(&outB[a * kw], 0); (b < k) && BIT(og, a); )
+            {
+                mk = (Wc[gs][a] != 0) + (Wc[a][b] != 0);
+                if ( (b == gs) || (mk == 0) || ((c = closeBits(gs, a, b, mk == 1)) == k) )
                 {
-                    if (i == len + 1)
-                    {
-                        // Take 1 step back
-                        i--;
-                        if (Wc[cycle[i-1]][cycle[i]])
-                        {
-                            cnt--;
-                        }
-                        cycle[i] = EOC;
-                        break;
-                    }
-                    gi = -1;                    // Start searching a next step
+                    b = nextBit(&outB[a * kw], b + 1);
+                    continue;
                 }
-            } // End for gi
+                cyc[0] = gs;
+                cyc[1] = a;
+                cyc[2] = b;
+                cyc[3] = c;
+                remBitsCycle(cyc, 4);
+                Nc++;
+                b = nextBit(&outB[a * kw], b);  // Same path again, if its edges are left
+            }
+        }
+    }
+    return Nc;
+}
+#endif // REF_SHORT_CYCLES
+
+typedef struct
+{
+    wgt_t    **W, **Wc;                     // Move matrix, marks of the calling thread; no job changes them
+    unsigned k, len;
+    unsigned lo;                            // Start node of job 0
+    unsigned *cyc;                          // cyc[i*(len+1) ..]: walk buffer of the job of start node lo+i
+    char     *found;                        // found[i] = 1 if the walk from start node lo+i found a cycle
+} walkCtx;
+
+/** Walk from gs as delCycles() does, in Wm with marks Wcm, to the first cycle of length len it can
+ * remove, into cyc (len+1 entries)
+ * Returns 1 if found
+ * 261018 Created
+ */
+static char walkFrom(wgt_t **Wm, wgt_t **Wcm, const unsigned kk, const unsigned gs, const unsigned len, unsigned *cyc)
+{
+    unsigned i, gi, ci, cnt = 0;
 
-            // Take 1 step back
-            i--;
-            if (i)
+    memset(cyc, UINT_MAX, (len + 1) * sizeof(unsigned));
+    cyc[0] = gs;
+    for (i = 1; i; )
+    {
+        for (gi = cyc[i] + 1; gi < kk; gi++)
+        {
+            if (i == len)
             {
-                if (Wc[cycle[i-1]][cycle[i]])
-                {
+                if (Wm[cyc[i-1]][gs])
+                    gi = gs;
+                else
+                    break;
+            }
+            if ( (cyc[i-1] == gi) || ((i < len) && (cyc[i] == gi)) || !Wm[cyc[i-1]][gi] )
+                continue;
+            if (Wcm[cyc[i-1]][gi])
+                cnt++;
+            if ((ci = add(cyc, &i, gi)) != OK)  // Node gi walked before
+            {
+                cyc[i] = EOC;
+                if ( (i - ci == len) && (cnt >= len - 1) )
+                    return 1;
+                i--;                        // Take >= 1 step back
+                if (Wcm[cyc[i-1]][cyc[i]])
                     cnt--;
-                }
+                cyc[i] = EOC;
+                break;
             }
-        } // End for i
+            gi = -1;                        // Search the next step
+        }
+        i--;                                // Take 1 step back
+        if ( i && Wcm[cyc[i-1]][cyc[i]] )
+            cnt--;
+    }
+    return 0;
+}
+
+/** Pool job: walk from start node lo+i as delCycles() does
+ * 261018 Created
+ */
+static void walkJob(void *ctx, const unsigned i, const unsigned tid)
+{
+    walkCtx *c = (walkCtx*)ctx;
+
+    (void)tid;
+    c->found[i] = walkFrom(c->W, c->Wc, c->k, c->lo + i, c->len, &c->cyc[(size_t)i * (c->len + 1)]);
+}
+
+/** Remove cycle cyc of length len from W, and 1 mark of each of its moves from Wc
+ * Returns 1 if an entry of W or Wc dropped to 0. A walk only tests whether the entries are 0, so
+ * otherwise each walk finds the same cycle as before
+ * 261018 Created
+ */
+static char remWalked(const unsigned *cyc, const unsigned len)
+{
+    unsigned p, a, b;
+    char changed = 0;
+
+    for (p = 0; p < len; p++)
+    {
+        a = cyc[p];
+        b = cyc[(p+1) % len];
+        decW(a, b);
+        if (W[a][b] == 0)
+            changed = 1;
+        if ( Wc[a][b] && (--Wc[a][b] == 0) )
+            changed = 1;
+    }
+    if (cycRec)
+        logCycle(cyc, len, 0);
+    OP_CYC(len);
+    return changed;
+}
+
+/** Delete cycles of length [len] from W
+ * 170803 Created
+ * 261018 Delete 3- and 4-cycles by delShortCycles()
+ * 261018 Stop when the budget runs out
+ * 261018 Walk by walkFrom(); do not walk again from the start nodes a removal did not change; walk
+ *        ahead from PAR_WALKS start nodes per thread on the thread pool, if k >= PAR_MIN_K
+ */
+unsigned delCycles(const unsigned len)
+{
+    unsigned gi, pj, gs, ci, Nmax;
+    unsigned lo = 0, Nw = 0;                // The walks from start nodes [lo, lo+Nw) are in c
+    unsigned Nc = 0;                        // #cycles removed
+    char found;
+    walkCtx c;
+
+    if (len == 2)
+    {
+        // Delete 2-cycles
+        for (gi = 0; gi < k; gi++)
+            for (pj = gi + 1; pj < k; pj++)
+                if ((ci = handleCycle(gi, pj))) // If there is >= 1 2-cycle => remove from W
+                    Nc += ci;               // Count #cycles removed
+        OP_ADD(OC_CYC2, Nc);
+        TR_CYCLE(2, Nc);
+
+        return Nc;                          // Ready
+    }
+#ifndef REF_SHORT_CYCLES
+    if ( (len == 3) || (len == 4) )
+        return delShortCycles(len);
+#endif // REF_SHORT_CYCLES
+
+    // Delete k-cycles, k >= 3: the first cycle that the walk from the lowest start node can remove, and
+    // restart. Until a removal changes whether an entry of W or Wc is 0, the start nodes below lo find
+    // no cycle and the walks in c stay valid, so they are not walked again
+    c.W   = W;
+    c.Wc  = Wc;
+    c.k   = k;
+    c.len = len;
+    Nmax  = ((parN > 1) && (k >= PAR_MIN_K)) ? parN * PAR_WALKS : 1;
+    if ( (Nmax == 1)
+            || ((c.cyc = (unsigned*)getPassRes((size_t)Nmax * ((len + 1) * sizeof(unsigned) + 1))) == NULL) )
+    {
+        Nmax    = 1;                        // Walk on this thread
+        c.cyc   = cycle;
+        c.found = &found;
+    }
+    else
+        c.found = (char*)&c.cyc[(size_t)Nmax * (len + 1)];
+    for (gs = 0; (gs < k) && !budgetOut(); gs++)
+    {
+        if (gs < lo)
+            continue;                       // Walked since the last change: no cycle
+        if (gs >= lo + Nw)
+        {
+            c.lo = lo = gs;
+            Nw   = (k - gs < Nmax) ? k - gs : Nmax;
+            if (Nw == 1)
+                c.found[0] = walkFrom(W, Wc, k, gs, len, c.cyc);
+            else
+                parFor(Nw, walkJob, &c);    // Walk ahead from gs
+        }
+        if (!c.found[gs - lo])
+            continue;
+        if (remWalked(&c.cyc[(size_t)(gs - lo) * (len + 1)], len))
+        {
+            OP_ADD(OC_SPEC_REJ, lo + Nw - gs - 1);
+            lo = Nw = 0;                    // Walk again from star 0
+        }
+        OP_INC(OC_RESTART);
+        Nc++;                               // +1 cycle removed
+        gs = -1;                            // Restart with gs = 0
     }
 
-    return Nc;                          // #cycles removed
+    return Nc;                              // #cycles removed
 }
 
 /** If node has 1 in-neighbour => simplify W
  * 170807 Created
+ * 261018 Take the in-degrees kept by incW(), decW()
  */
 char ruleB()
 {
-    unsigned pi, pj, pin, cnt;
+    unsigned pi, pj, pin;
     char applied = 0;                       // Rule applied (1) or not (0)
 
     for (pi = 0; pi < k; pi++)
     {
-        cnt = 0;
-        for (pj = 0; pj < k; pj++)
-        {
-            if ( (pj != pi) && W[pj][pi])
-            {
-                cnt++;
-                pin = pj;
-            }
-        }
-        if (cnt == 1)                       // If in-degree = out-degree = 1 => replace adjacent edges
+        if (inDeg[pi] == 1)                 // If in-degree = out-degree = 1 => replace adjacent edges
         {
+            for (pin = 0; (pin == pi) || !W[pin][pi]; pin++);
             for (pj = 0; pj < k; pj++)
             {
                 if ( (pj != pi) && (pj != pin) && W[pi][pj])   // For each outgoing edge (i,j)
                 {
-                    W[pin][pi]--;           // Remove edge (in,i)
-                    W[pi][pj]--;            // Remove edge (i,j)
-                    W[pin][pj]++;           // Add edge (in,j)
-                    printf("B(%2u->%2u->%2u)\n", pin+1, pi+1, pj+1);
+                    decW(pin, pi);          // Remove edge (in,i)
+                    decW(pi, pj);           // Remove edge (i,j)
+                    incW(pin, pj);          // Add edge (in,j)
+                    if (cycRec)
+                        logContract(pin, pi, pj);
+                    OP_INC(OC_RULE_B);
+                    if (dbg)
+                        printf("B(%2u->%2u->%2u)\n", pin+1, pi+1, pj+1);
                     applied = 1;
                 }
             }
@@ -706,33 +1359,30 @@ char ruleB()
 
 /** If node has 1 out-neighbour => simplify W
  * 170807 Created
+ * 261018 Take the out-degrees kept by incW(), decW()
  */
 char ruleC()
 {
-    unsigned pi, pj, pout, cnt;
+    unsigned pi, pj, pout;
     char applied = 0;                       // Rule applied (1) or not (0)
 
     for (pi = 0; pi < k; pi++)
     {
-        cnt = 0;
-        for (pj = 0; pj < k; pj++)
-        {
-            if ( (pj != pi) && W[pi][pj])
-            {
-                cnt++;
-                pout = pj;
-            }
-        }
-        if (cnt == 1)                       // If in-degree = out-degree = 1 => replace adjacent edges
+        if (outDeg[pi] == 1)                // If in-degree = out-degree = 1 => replace adjacent edges
         {
+            for (pout = 0; (pout == pi) || !W[pi][pout]; pout++);
             for (pj = 0; pj < k; pj++)
             {
                 if ( (pj != pi) && (pj != pout) && W[pj][pi])   // For each incoming edge (j,i)
                 {
-                    W[pj][pi]--;            // Remove edge (j,i)
-                    W[pi][pout]--;          // Remove edge (i,out)
-                    W[pj][pout]++;          // Add edge (j,out)
-                    printf("C(%2u->%2u->%2u)\n", pj+1, pi+1, pout+1);
+                    decW(pj, pi);           // Remove edge (j,i)
+                    decW(pi, pout);         // Remove edge (i,out)
+                    incW(pj, pout);         // Add edge (j,out)
+                    if (cycRec)
+                        logContract(pj, pi, pout);
+                    OP_INC(OC_RULE_C);
+                    if (dbg)
+                        printf("C(%2u->%2u->%2u)\n", pj+1, pi+1, pout+1);
                     applied = 1;
                 }
             }
@@ -742,38 +1392,268 @@ char ruleC()
     return applied;
 }
 
+static TLS unsigned Nwork;               // #nodes in the worklist
+
+/** Add node i to the worklist if it has 1 in- or out-neighbour
+ * 261018 Created
+ */
+static inline void kPush(const unsigned i)
+{
+    if ( !inWork[i] && ((inDeg[i] == 1) || (outDeg[i] == 1)) )
+    {
+        inWork[i] = 1;
+        kWork[Nwork++] = i;
+    }
+}
+
+/** Remove 1 move i -> j (i != j) from W, and add i, j to the worklist if their degree changed
+ * 261018 Created
+ */
+static void kDecW(const unsigned i, const unsigned j)
+{
+    decW(i, j);
+    if (W[i][j] == 0)
+    {
+        kPush(i);
+        kPush(j);
+    }
+}
+
+/** Add 1 move i -> j (i != j) to W, and add i, j to the worklist if their degree changed
+ * 261018 Created
+ */
+static void kIncW(const unsigned i, const unsigned j)
+{
+    incW(i, j);
+    if (W[i][j] == 1)
+    {
+        kPush(i);
+        kPush(j);
+    }
+}
+
+/** Remove the 2-cycles between nodes i and j, and add i, j to the worklist
+ * Returns the #2-cycles removed
+ * 261018 Created
+ */
+static unsigned kDel2cycles(const unsigned i, const unsigned j)
+{
+    unsigned cnt;
+
+    if ( !W[i][j] || !W[j][i] )
+        return 0;
+    cnt = handleCycle(i, j);
+    OP_ADD(OC_CYC2, cnt);
+    kPush(i);
+    kPush(j);
+    return cnt;
+}
+
+/** Kernelize W: contract all paths a -> i -> b through the nodes i with 1 in-neighbour a (ruleB())
+ * or 1 out-neighbour b (ruleC()), and remove the 2-cycles this creates, until nothing changes.
+ * The degrees are those kept by incW(), decW(); a node is only handled when its degree drops to 1
+ * (worklist), in O(k) per node. The contractions are logged like those of ruleB(), ruleC().
+ * Returns the #2-cycles removed; *applied is set if W was changed
+ * 261018 Created
+ */
+unsigned kernelize(char *applied)
+{
+    unsigned i, a, b, c, Nc = 0;
+
+    TR_BEGIN(TN_KERNELIZE, 0);
+    *applied = 0;
+    memset(inWork, 0, k * sizeof(char));
+    Nwork = 0;
+    for (i = 0; i < k; i++)
+        kPush(i);
+
+    while (Nwork && !GIVE_UP)
+    {
+        i = kWork[--Nwork];
+        inWork[i] = 0;
+        if (inDeg[i] == 1)                      // ruleB(): every move out of i comes from a
+        {
+            for (a = 0; (a == i) || !W[a][i]; a++);
+            for (b = 0; b < k; b++)
+            {
+                if ( (b == i) || (b == a) || !W[i][b] )
+                    continue;
+                for (c = W[i][b]; c; c--)
+                {
+                    kDecW(a, i);
+                    kDecW(i, b);
+                    kIncW(a, b);
+                    if (cycRec)
+                        logContract(a, i, b);
+                    OP_INC(OC_RULE_B);
+                    if (dbg)
+                        printf("B(%2u->%2u->%2u)\n", a+1, i+1, b+1);
+                }
+                Nc += kDel2cycles(a, b);
+                *applied = 1;
+            }
+            Nc += kDel2cycles(a, i);
+        }
+        else if (outDeg[i] == 1)                // ruleC(): every move into i goes on to b
+        {
+            for (b = 0; (b == i) || !W[i][b]; b++);
+            for (a = 0; a < k; a++)
+            {
+                if ( (a == i) || (a == b) || !W[a][i] )
+                    continue;
+                for (c = W[a][i]; c; c--)
+                {
+                    kDecW(a, i);
+                    kDecW(i, b);
+                    kIncW(a, b);
+                    if (cycRec)
+                        logContract(a, i, b);
+                    OP_INC(OC_RULE_C);
+                    if (dbg)
+                        printf("C(%2u->%2u->%2u)\n", a+1, i+1, b+1);
+                }
+                Nc += kDel2cycles(a, b);
+                *applied = 1;
+            }
+            Nc += kDel2cycles(i, b);
+        }
+    }
+    if (Nc)
+        *applied = 1;
+    TR_END(TN_KERNELIZE);
+    return Nc;
+}
+
+/** Test if getDecomp() has used up its budget. Each call is 1 operation: 1 round of the loops of decompRest(), or
+ * 1 row of markWc() or start star of delShortCycles(), delCycles(), with or without the thread pool
+ * 261018 Created
+ */
+static char budgetOut()
+{
+    if (!decompFull)
+        return 1;
+    budgetN++;
+    if ( (budgetOps && (budgetN > budgetOps)) || (budgetNs && (nsNow() - budgetT0 > budgetNs)) )
+        decompFull = 0;
+    return !decompFull;
+}
+
+/** Remove the cycles of W greedily: walk along the first out-edge of each star until a star
+ * is visited again, and remove that cycle. Each cycle takes O(kL) time.
+ * Returns the #cycles removed
+ * 261018 Created
+ */
+static unsigned delCyclesGreedy()
+{
+    unsigned gs, g, gj, i, p, len = 0, cnt = 0;
+
+    for (g = 0; g < k; g++)
+        P[g] = UINT_MAX;                        // Position of star g in the walk
+    for (gs = 0; (gs < k) && !GIVE_UP; )
+    {
+        g = len ? cycle[len-1] : gs;
+        for (gj = 0; (gj < k) && ((gj == g) || !W[g][gj]); gj++);
+        if (gj == k)
+        {
+            if ( len && anomaly(ERR_NO_CYCLE, "! Greedy: star %u has no out-edge\n", g+1) )
+                break;
+            while (len)
+                P[cycle[--len]] = UINT_MAX;
+            gs++;                               // Star gs is done
+            continue;
+        }
+        if (P[gj] == UINT_MAX)
+        {
+            if (len == 0)
+            {
+                P[g] = 0;
+                cycle[len++] = g;
+            }
+            P[gj] = len;
+            cycle[len++] = gj;
+            continue;
+        }
+        p = P[gj];                              // Cycle cycle[p] -> .. -> cycle[len-1] -> cycle[p]
+        for (i = p; i < len; i++)
+            decW(cycle[i], i + 1 < len ? cycle[i+1] : cycle[p]);
+        if (cycRec)
+            logCycle(&cycle[p], len - p, 0);
+        OP_CYC(len - p);
+        cnt++;
+        while (len > p)
+            P[cycle[--len]] = UINT_MAX;
+    }
+    return cnt;
+}
 
-/** Get an optimal cycle decomposition
+/** Get an optimal cycle decomposition. If the budget (budgetNs, budgetOps) runs out, the rest of W
+ * is decomposed greedily and decompFull is cleared.
  * 170802 Created
+ * 261018 Time and operation budget
+ * 261018 Trace its span and those of delCycles()
+ * 261018 Take the decomposition of a residual on few stars from the table in use (table.c)
+ * 261018 Split off decompRest()
  */
 unsigned getDecomp()
 {
-    unsigned pi, pj, beta = n, lmin, cnt;
-    unsigned Niter;
+    unsigned pi, beta = n, cnt;
 
+    OP_PHASE(PH_DECOMP);
+    TR_BEGIN(TN_DECOMP, 0);
     for (pi = 0; pi < k; pi++)
         beta -= W[pi][pi];              // These qubits don't have to be moved
-    beta -= del2cycles();               // Delete 2-cycles and count them
+    cnt   = del2cycles();               // Delete 2-cycles and count them
+    beta -= cnt;
+    OP_ADD(OC_CYC2, cnt);
+    TR_CYCLE(2, cnt);
+    beta = decompRest(beta);
+    setW();     // Recover W
+    TR_END(TN_DECOMP);
+    OP_PHASE(PH_ROUTE);
+
+    return beta;
+}
+
+/** Decompose the rest of W once its 2-cycles are removed, within the budget (budgetNs, budgetOps),
+ * starting from beta. W is left empty.
+ * Returns beta
+ * 261018 Created from getDecomp(), to resume it on a W set up by the lockstep solver (lanes.c)
+ */
+unsigned decompRest(unsigned beta)
+{
+    unsigned pi, lmin, cnt;
+    unsigned Niter;
+#ifndef REF_RULES
+    char applied;
+#endif // REF_RULES
+
+    decompFull = 1;
+    budgetN    = 0;
+    if (budgetNs)
+        budgetT0 = nsNow();
     for (pi = 0; pi < k; pi++)
-        memset(Wc[pi], 0, k * sizeof(unsigned));
+        memset(Wc[pi], 0, k * sizeof(wgt_t));
+#ifndef REF_RULES
+    beta -= kernelize(&applied);        // Shrink W before the first search
+#endif // REF_RULES
 
-    while (!emptyGraph())
+    while (!emptyGraph() && !GIVE_UP && !budgetOut())
     {
+        if ((cnt = tabSolve()) != TAB_MISS)
+        {
+            beta -= cnt;                // Optimal for the rest of W
+            break;
+        }
         lmin = getMinCycleLen();
+        if (GIVE_UP)
+            break;
 
-        for (Niter = 0; (Niter <= 2) && (getMinCycleLen() == lmin); Niter++)
+        for (Niter = 0; (Niter <= 2) && !GIVE_UP && !budgetOut() && (getMinCycleLen() == lmin); Niter++)
         {
-            for (pi = 0; pi < k; pi++)
-            {
-                for (pj = 0; pj < k; pj++)
-                {
-                    if ( (pj != pi) && W[pi][pj] && wShortestPaths(pj, pi) )
-                    {
-                        Wc[pi][pj] = 1;
-                    }
-                }
-            }
+            markWc();
+            TR_BEGIN(TN_DEL_CYCLES, lmin);
             cnt = delCycles(lmin);
+            TR_END(TN_DEL_CYCLES);
             if (cnt)
             {
                 beta -= cnt;
@@ -783,41 +1663,74 @@ unsigned getDecomp()
                 break;
             if (Niter == 1)
             {
+#ifdef REF_RULES
                 if (ruleB())
                     break;
                 if (ruleC())
                     break;
+#else
+                beta -= kernelize(&applied);
+                if (applied)
+                    break;
+#endif // REF_RULES
             }
             else if (Niter == 2)
             {
                 // 'Randomly' remove one of the cycles
                 for (pi = 0; (pi < k) && !delCycle(pi, lmin, 2); pi++);
                 if (pi < k)         // If success
+                {
                     beta--;
+                    OP_INC(OC_FB2);
+                    OP_CYC(lmin);
+                }
                 else                // If no success
                 {
                     for (pi = 0; (pi < k) && !delCycle(pi, lmin, 5); pi++);
                     if (pi < k)     // If success
+                    {
                         beta--;
+                        OP_INC(OC_FB5);
+                        OP_CYC(lmin);
+                    }
                     else
                     {
                         for (pi = 0; (pi < k) && !delCycle(pi, lmin, 6); pi++);
                         if (pi < k)     // If success
-                            beta--;
-                        else
                         {
-                            printW();
-                            puts("No success!");
-                            getchar();
+                            beta--;
+                            OP_INC(OC_FB6);
+                            OP_CYC(lmin);
                         }
+                        else
+                            anomaly(ERR_NO_CYCLE, "No success!\n");
                     }
                 }
                 break;
             }
         } // End for Niter
     }
-    setW();     // Recover W
+    if (!decompFull && !GIVE_UP)
+        beta -= delCyclesGreedy();      // Out of budget: finish greedily
+    return beta;
+}
 
+/** Get a cycle decomposition within a budget of ns nanoseconds and ops operations (0: no limit)
+ * Returns beta; *full = 1 if the result is the full-effort one of getDecomp()
+ * 261018 Created
+ */
+unsigned getDecompBudget(const unsigned long long ns, const unsigned long long ops, char *full)
+{
+    unsigned beta;
+    const unsigned long long ns0 = budgetNs, ops0 = budgetOps;
+
+    budgetNs  = ns;
+    budgetOps = ops;
+    beta      = getDecomp();
+    budgetNs  = ns0;
+    budgetOps = ops0;
+    if (full)
+        *full = decompFull;
     return beta;
 }
 
@@ -843,11 +1756,11 @@ static unsigned add(unsigned *v, unsigned *len, const unsigned num)
  */
 unsigned getDestStar(const unsigned j)
 {
-    const int posYj = inv(y, x[j]);
+    const int posYj = inv(y, LAB(x, j));
     if (posYj == -1)
     {
-        puts("! posYj = -1");
-        exit(EXIT_FAILURE);
+        anomaly(ERR_NO_DEST, "! posYj = -1\n");
+        return j/(m+1);                 // Leave it
     }
     return posYj/(m+1);
 }
@@ -857,46 +1770,92 @@ unsigned getDestStar(const unsigned j)
  */
 char destIsCentre(const unsigned j)
 {
-    return inv(y, x[j]) % (m+1) == 0;
+    return inv(y, LAB(x, j)) % (m+1) == 0;
 }
 
 /** Set move matrix W and centre move matrix Wc
  * 170411 Created
+ * 261018 Read the labels in their own width
+ * 261018 Count the degrees of W by incW()
+ * 261018 Count the weights of W too, and check W(i,j) <= m+1 once here
+ * 261018 Check the flow of each star by its weights instead: m+1 moves out, m+1 in
  */
 void setW()
 {
     unsigned i;
-    int di;
 
-    if (x[0] > n)
+    OP_INC(OC_SETW);
+    if (LAB(x, 0) > n)
     {
-        memcpy(x, x0, n * sizeof(unsigned));
-        puts("! setW: x was not set");
-        getchar();
+        memcpy(x, x0, n * labW);
+        anomaly(ERR_X_UNSET, "! setW: x was not set\n");
     }
     for (i = 0; i < k; i++)
     {
-        memset(W[i], 0, k * sizeof(unsigned));
-        memset(Wc[i], 0, k * sizeof(unsigned));
+        memset(W[i], 0, k * sizeof(wgt_t));
+        memset(Wc[i], 0, k * sizeof(wgt_t));
+        memset(WT[i], 0, k * sizeof(wgt_t));
     }
+    memset(inDeg, 0, k * sizeof(unsigned));
+    memset(outDeg, 0, k * sizeof(unsigned));
+    memset(inW, 0, k * sizeof(unsigned));
+    memset(outW, 0, k * sizeof(unsigned));
+    wOff = 0;
+    if (labW == 2)
+        setW16((const lab16*)x, (const lab16*)y);
+    else
+        setW32((const unsigned*)x, (const unsigned*)y);
+    for (i = 0; i < k; i++)             // Each of the m+1 labels of a star leaves it, and m+1 arrive
+        if ( ((outW[i] + W[i][i] != m + 1) || (inW[i] + W[i][i] != m + 1))
+                && anomaly(ERR_W_RANGE, "! Star %u: %u moves out, %u in, not %u\n", i+1, outW[i] + W[i][i], inW[i] + W[i][i], m+1) )
+            return;
+}
+
+/** Add the moves of the 16-bit labels xs to W and Wc
+ * 261018 Created
+ */
+static void setW16(const lab16 *xs, const lab16 *ys)
+{
+    unsigned i;
+    int pos;
+
     for (i = 0; i < n; i++)
     {
-        if (x[i] == 0)
+        if (xs[i] == 0)
             continue;
-        di = getDestStar(i);                // Get destination
-        if (di == -1)
+        pos = inv16(ys, xs[i]);             // Get destination
+        if (pos == -1)
         {
-            puts("! di = -1");
-            exit(EXIT_FAILURE);
+            anomaly(ERR_NO_DEST, "! di = -1\n");
+            continue;
         }
-        else if (di > n)
+        incW(i/(m+1), pos/(m+1));
+        if (pos % (m+1) == 0)               // If xi has a centre destination
+            Wc[i/(m+1)][pos/(m+1)]++;
+    }
+}
+
+/** Add the moves of the 32-bit labels xs to W and Wc
+ * 261018 Created
+ */
+static void setW32(const unsigned *xs, const unsigned *ys)
+{
+    unsigned i;
+    int pos;
+
+    for (i = 0; i < n; i++)
+    {
+        if (xs[i] == 0)
+            continue;
+        pos = inv32(ys, xs[i]);             // Get destination
+        if (pos == -1)
         {
-            printf("! di: %u\n", di);
-            exit(EXIT_FAILURE);
+            anomaly(ERR_NO_DEST, "! di = -1\n");
+            continue;
         }
-        W[i/(m+1)][di]++;
-        if (destIsCentre(i))                // If xi has a centre destination
-            Wc[i/(m+1)][di]++;
+        incW(i/(m+1), pos/(m+1));
+        if (pos % (m+1) == 0)               // If xi has a centre destination
+            Wc[i/(m+1)][pos/(m+1)]++;
     }
 }
 
@@ -6,36 +6,70 @@
  */
 
 #define SET_M   5               // Set m to a predefined value: 5 leaves/star
+#define TLS     __thread        // Thread-local storage: each solver thread has its own problem
 
 #include <limits.h>
 #include <math.h>
 
 #define OK                  UINT_MAX
+// Node labels are stored in 16 bits if n <= LAB16_MAX, otherwise in 32 bits
+#define LAB16_MAX           USHRT_MAX
+#define LAB(v, i)           ((labW == 2) ? (unsigned)((const lab16*)(v))[i] : ((const unsigned*)(v))[i])   // Get label i of vector v
+#define SET_LAB(v, i, l)    ((labW == 2) ? (void)(((lab16*)(v))[i] = (lab16)(l)) : (void)(((unsigned*)(v))[i] = (l)))
+
+typedef unsigned short lab16;   // 16-bit node label
 
 // External variables
-extern unsigned k, m, n, Nd;    // #stars, #nodes/star, total #nodes, #digits to represent node labels
-extern unsigned Nc;             // #clauses, #digits of decimal variable number
+extern TLS unsigned k, m, n, Nd;    // #stars, #nodes/star, total #nodes, #digits to represent node labels
+extern unsigned Nc;                 // #clauses, #digits of decimal variable number
+extern TLS unsigned char labW;      // #bytes/node label: 2 or 4
+
+static TLS unsigned long long rndState; // State of the random generator of this thread
 
 // Function prototypes
-int inv(const unsigned *y, const unsigned yi);
+int inv(const void *y, const unsigned yi);
+static int inv16(const lab16 *y, const unsigned yi);
+static int inv32(const unsigned *y, const unsigned yi);
+
+/** Seed the random generator of this thread
+ * 261018 Created
+ */
+void srnd(const unsigned long long seed)
+{
+    rndState = seed;
+}
+
+/** Get a random number (splitmix64). Unlike rand(), each thread has its own
+ * generator, so a seed gives the same numbers on any thread.
+ * 261018 Created
+ */
+unsigned rnd()
+{
+    unsigned long long z = (rndState += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned)((z ^ (z >> 31)) >> 32);
+}
 
 /** Shuffle vector x
  * 170414 Created
+ * 261018 Use the random generator of this thread
  */
-void setRandom(unsigned *x)
+void setRandom(void *x)
 {
     unsigned i, v1, v2, valT;
 
     for (i = 0; i < n; i++)
-        x[i] = i + 1;
+        SET_LAB(x, i, i + 1);
     for (i = n*n/2; i; i--)
     {
         // Randomly shuffle current node values
-        v1 = rand() % n;
-        v2 = rand() % n;            // Randomly select node numbers to shuffle value thereof
-        valT = x[v1];               // Temporarily store value
-        x[v1] = x[v2];
-        x[v2] = valT;
+        v1 = rnd() % n;
+        v2 = rnd() % n;             // Randomly select node numbers to shuffle value thereof
+        valT = LAB(x, v1);          // Temporarily store value
+        SET_LAB(x, v1, LAB(x, v2));
+        SET_LAB(x, v2, valT);
     }
 }
 
@@ -43,7 +77,7 @@ void setRandom(unsigned *x)
  * 170321 Created
  * 170407 Removed fprintf to SAT file
  */
-void getVals(unsigned *vals, const unsigned minOne)
+void getVals(void *vals, const unsigned minOne)
 {
     unsigned i, ni, val, x;
     char in[10];
@@ -63,10 +97,10 @@ void getVals(unsigned *vals, const unsigned minOne)
             if (val >= n)
             {
                 printf("! %u >= n = %u, I'll make this 0\n", val, n);
-                vals[ni] = 0;
+                SET_LAB(vals, ni, 0);
             }
             else
-                vals[ni] = val;
+                SET_LAB(vals, ni, val);
         }
         else
         {
@@ -84,7 +118,7 @@ void getVals(unsigned *vals, const unsigned minOne)
                 }
                 // Set input in increasing order: (n-1, n-2, ..., 1, 0)
                 for (i = 0; i < n; i++)
-                    vals[i] = i;
+                    SET_LAB(vals, i, i);
                 printf("> Input values set in increasing order: (1, ..., %u)\n", n);
             }
             return;
@@ -98,7 +132,7 @@ void getVals(unsigned *vals, const unsigned minOne)
                 // Set input in decreasing order: (n-1, n-2, ..., 1, 0)
                 for (i = 0, val = n - 1; i < n; i++, val = n - i - 1)
                 {
-                    vals[i] = val;
+                    SET_LAB(vals, i, val);
                 }
                 printf("> Input values set in decreasing order: (%u, ..., 1)\n", n);
             }
@@ -126,7 +160,7 @@ void getVals(unsigned *vals, const unsigned minOne)
 /** Check if values are unique and in [1, n]
  * 170411 Created
  */
-unsigned checkVals(const unsigned *vals)
+unsigned checkVals(const void *vals)
 {
     unsigned i;
 
@@ -139,7 +173,29 @@ unsigned checkVals(const unsigned *vals)
 /** Get inverse mapping of c(i) = y_i
  * 170410 Created
  */
-int inv(const unsigned *y, const unsigned yi)
+int inv(const void *y, const unsigned yi)
+{
+    return (labW == 2) ? inv16((const lab16*)y, yi) : inv32((const unsigned*)y, yi);
+}
+
+/** Get inverse mapping of c(i) = y_i for 16-bit labels
+ * 261018 Created
+ */
+static int inv16(const lab16 *y, const unsigned yi)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+        if (y[i] == yi)
+            return i;
+
+    return -1;          // No inverse mapping found
+}
+
+/** Get inverse mapping of c(i) = y_i for 32-bit labels
+ * 261018 Created
+ */
+static int inv32(const unsigned *y, const unsigned yi)
 {
     unsigned i;
 
@@ -153,13 +209,13 @@ int inv(const unsigned *y, const unsigned yi)
 /** Print sorted input values
  * 170321 Created
  */
-void printVals(unsigned *vals)
+void printVals(const void *vals)
 {
     unsigned i;
 
     printf("  n val\n-------\n");
     for (i = 0; i < n; i++)
-        printf("%*u %*u\n", Nd, i + 1, Nd, vals[i]);
+        printf("%*u %*u\n", Nd, i + 1, Nd, LAB(vals, i));
 }
 
 
@@ -193,11 +249,39 @@ void getParams()
 #endif // SET_M
 }
 
-/** Set the parameters n, e, Nd, using k and m
+/** Get #processors, the default #threads
+ * 261018 Created
+ */
+unsigned getNcpu()
+{
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+}
+
+/** Get the time in ns from a monotonic clock
+ * 261018 Created
+ */
+unsigned long long nsNow()
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (unsigned long long)(t.QuadPart / freq.QuadPart) * 1000000000ULL
+         + (unsigned long long)(t.QuadPart % freq.QuadPart) * 1000000000ULL / freq.QuadPart;
+}
+
+/** Set the parameters n, e, Nd, labW, using k and m
  * 170524 Created
+ * 261018 Set label width labW
  */
 void initParams()
 {
     n = k*(m+1);                // #nodes
     Nd = ceil(log10(n+1));      // #digits of node numbers
+    labW = (n <= LAB16_MAX) ? sizeof(lab16) : sizeof(unsigned); // Use 16-bit labels if possible
 }
@@ -0,0 +1,196 @@
+/** Lockstep decomposition of small instances: LANES instances of the same problem at a time
+ *
+ * For small k the work per instance in setW(), del2cycles() and the degree checks of the residual
+ * is tiny, so the calls and branches around it dominate. Here the move matrices of LANES instances
+ * are interleaved by lane: entry (gi, gj) of all lanes is 1 vector of LANES weights (structure of
+ * arrays), and the 2-cycles are removed and the degrees of the residual counted for all lanes by 1
+ * SSE2 instruction per step. W is built from a table of the star of each label in y, in O(n) instead
+ * of the search of setW().
+ *
+ * A lane is done if its residual is empty, or if each star has at most 1 in- and 1 out-neighbour:
+ * then the residual is a set of disjoint simple cycles, each of 1 weight (flow conservation), and
+ * its decomposition is forced. The other lanes go on in the scalar decompRest() from their residual,
+ * so each lane gets the beta of getDecomp().
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define LANES           8               // #instances solved in lockstep: 1 SSE2 vector of 16-bit weights
+#define LANE_MAX_K      16              // Max #centres to solve in lockstep; the stars of a lane fit a 16-bit mask
+
+static TLS arena    laneArena;          // Block with the lane buffers of this thread
+static TLS wgt_t    *lW;                // lW[(gi*k + gj)*LANES + l] = W(gi,gj) of lane l
+static TLS wgt_t    *lOut, *lIn;        // #out-, #in-neighbours per star and lane in the residual
+static TLS unsigned *lDest;             // lDest[l] = star of label l in y
+
+#define LW(gi, gj)      (&lW[((gi) * k + (gj)) * LANES])
+
+/** Set up the lane buffers of this thread for the problem, and empty the lanes
+ * Returns 0 if out of memory
+ * 261018 Created
+ */
+char laneStart()
+{
+    const size_t mat = ALIGN_UP((size_t)k * k * LANES * sizeof(wgt_t)),
+                 deg = ALIGN_UP((size_t)k * LANES * sizeof(wgt_t));
+
+    if (!arenaReserve(&laneArena, mat + 2 * deg + ALIGN_UP((n + 1) * sizeof(unsigned)), 0))
+        return 0;
+    lW    = (wgt_t*)arenaAlloc(&laneArena, mat);
+    lOut  = (wgt_t*)arenaAlloc(&laneArena, deg);
+    lIn   = (wgt_t*)arenaAlloc(&laneArena, deg);
+    lDest = (unsigned*)arenaAlloc(&laneArena, (n + 1) * sizeof(unsigned));
+    memset(lW, 0, mat);
+    return 1;
+}
+
+/** Release the lane buffers of this thread
+ * 261018 Created
+ */
+void laneFree()
+{
+    arenaFree(&laneArena);
+    lW = lOut = lIn = NULL;
+    lDest = NULL;
+}
+
+/** Add the moves of the instance x0, y to lane l, which is empty
+ * 261018 Created
+ */
+void laneAdd(const unsigned l)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+        lDest[LAB(y, i)] = i/(m+1);
+    for (i = 0; i < n; i++)
+        LW(i/(m+1), lDest[LAB(x0, i)])[l]++;
+}
+
+/** Get the #cycles of the residual of lane l, of which each star has at most 1 in- and 1
+ * out-neighbour: the weights of 1 edge per simple cycle
+ * 261018 Created
+ */
+static unsigned laneCycles(const unsigned l)
+{
+    unsigned gs, g, gj, cnt = 0, seen = 0;
+
+    for (gs = 0; gs < k; gs++)
+    {
+        for (g = gs; !(seen & (1u << g)); g = gj)
+        {
+            seen |= 1u << g;
+            for (gj = 0; (gj < k) && ((gj == g) || !LW(g, gj)[l]); gj++);
+            if (gj == k)
+                break;                  // Star without moves
+            if (g == gs)
+                cnt += LW(g, gj)[l];
+        }
+    }
+    return cnt;
+}
+
+/** Decompose the lanes as far as they go in lockstep: get alpha, and beta so far, per lane. Lane l is
+ * done (done[l] = 1) if beta[l] is final; otherwise its residual has a star of degree > 1 (laneGet()).
+ * Empty lanes are done, with alpha = beta = n.
+ * 261018 Created
+ */
+void laneDecomp(unsigned *alpha, unsigned *beta, char *done)
+{
+    unsigned gi, gj, l;
+    unsigned cnt[LANES];
+    wgt_t nz[LANES], bad[LANES];
+#ifdef USE_SSE2
+    __m128i a, b, c, ma, mb, accLo, accHi, nzAll, badAll;
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+#else
+    wgt_t a, b, c;
+#endif // USE_SSE2
+
+    memset(lOut, 0, k * LANES * sizeof(wgt_t));
+    memset(lIn, 0, k * LANES * sizeof(wgt_t));
+    for (l = 0; l < LANES; l++)
+        alpha[l] = n;
+    for (gi = 0; gi < k; gi++)
+        for (l = 0; l < LANES; l++)
+            alpha[l] -= LW(gi, gi)[l];  // These qubits don't have to be moved
+
+    // Remove the 2-cycles of each pair of stars, and count the neighbours in the residual
+#ifdef USE_SSE2
+    accLo = accHi = nzAll = badAll = zero;
+    for (gi = 0; gi < k; gi++)
+        for (gj = gi + 1; gj < k; gj++)
+        {
+            a = _mm_load_si128((const __m128i*)LW(gi, gj));     // Lanes are ARENA_ALIGN aligned
+            b = _mm_load_si128((const __m128i*)LW(gj, gi));
+            c = _mm_sub_epi16(a, _mm_subs_epu16(a, b));         // min(W(i,j), W(j,i))
+            a = _mm_sub_epi16(a, c);
+            b = _mm_sub_epi16(b, c);
+            _mm_store_si128((__m128i*)LW(gi, gj), a);
+            _mm_store_si128((__m128i*)LW(gj, gi), b);
+            accLo = _mm_add_epi32(accLo, _mm_unpacklo_epi16(c, zero));
+            accHi = _mm_add_epi32(accHi, _mm_unpackhi_epi16(c, zero));
+            ma = _mm_andnot_si128(_mm_cmpeq_epi16(a, zero), one);   // 1 if edge i -> j is left
+            mb = _mm_andnot_si128(_mm_cmpeq_epi16(b, zero), one);
+            nzAll = _mm_or_si128(nzAll, _mm_or_si128(ma, mb));
+            _mm_store_si128((__m128i*)&lOut[gi * LANES], _mm_add_epi16(_mm_load_si128((const __m128i*)&lOut[gi * LANES]), ma));
+            _mm_store_si128((__m128i*)&lIn[gj * LANES], _mm_add_epi16(_mm_load_si128((const __m128i*)&lIn[gj * LANES]), ma));
+            _mm_store_si128((__m128i*)&lOut[gj * LANES], _mm_add_epi16(_mm_load_si128((const __m128i*)&lOut[gj * LANES]), mb));
+            _mm_store_si128((__m128i*)&lIn[gi * LANES], _mm_add_epi16(_mm_load_si128((const __m128i*)&lIn[gi * LANES]), mb));
+        }
+    for (gi = 0; gi < k; gi++)          // Degree > 1
+        badAll = _mm_or_si128(badAll, _mm_or_si128(_mm_cmpgt_epi16(_mm_load_si128((const __m128i*)&lOut[gi * LANES]), one),
+                                                   _mm_cmpgt_epi16(_mm_load_si128((const __m128i*)&lIn[gi * LANES]), one)));
+    _mm_storeu_si128((__m128i*)cnt, accLo);
+    _mm_storeu_si128((__m128i*)&cnt[4], accHi);
+    _mm_storeu_si128((__m128i*)nz, nzAll);
+    _mm_storeu_si128((__m128i*)bad, badAll);
+#else
+    memset(cnt, 0, sizeof(cnt));
+    memset(nz, 0, sizeof(nz));
+    memset(bad, 0, sizeof(bad));
+    for (gi = 0; gi < k; gi++)
+        for (gj = gi + 1; gj < k; gj++)
+            for (l = 0; l < LANES; l++)
+            {
+                a = LW(gi, gj)[l];
+                b = LW(gj, gi)[l];
+                c = a < b ? a : b;
+                LW(gi, gj)[l] = a -= c;
+                LW(gj, gi)[l] = b -= c;
+                cnt[l] += c;
+                nz[l]  |= a | b;
+                lOut[gi * LANES + l] += (a != 0);
+                lIn[gj * LANES + l]  += (a != 0);
+                lOut[gj * LANES + l] += (b != 0);
+                lIn[gi * LANES + l]  += (b != 0);
+            }
+    for (gi = 0; gi < k; gi++)
+        for (l = 0; l < LANES; l++)
+            bad[l] |= (lOut[gi * LANES + l] > 1) || (lIn[gi * LANES + l] > 1);
+#endif // USE_SSE2
+
+    for (l = 0; l < LANES; l++)
+    {
+        beta[l] = alpha[l] - cnt[l];
+        done[l] = !bad[l];
+        if (nz[l] && !bad[l])
+            beta[l] -= laneCycles(l);   // Disjoint simple cycles
+    }
+}
+
+/** Load the residual of lane l into W, WT of this thread, to go on by decompRest()
+ * 261018 Created
+ * 261018 Count its degrees
+ * 261018 Count its weights
+ */
+void laneGet(const unsigned l)
+{
+    unsigned gi, gj;
+
+    for (gi = 0; gi < k; gi++)
+        for (gj = 0; gj < k; gj++)
+            W[gi][gj] = WT[gj][gi] = LW(gi, gj)[l];
+    countW();
+}
@@ -0,0 +1,273 @@
+/** Functions to enumerate the elementary cycles of the move graph G' (given by W)
+ * up to a maximum length and to get a histogram of the cycle lengths.
+ *
+ * Cycles are enumerated by backtracking: each cycle is reported once, from its smallest node s,
+ * walking only over nodes > s. A step to node j is only taken if the BFS distance from j back to s
+ * fits in the length left, so only the O(k) path and the O(k) distances are stored; cycles are
+ * streamed to a callback. Unlike Johnson's algorithm there are no blocked sets: the way back to s
+ * may run over nodes of the walk, so walks can end without a cycle. A walk costs O(k) per step and
+ * there are up to k^(maxLen-1) walks per start node, so enumCycles() takes O(k^(maxLen+1)) time on
+ * a dense W instead of O(k) per cycle; keep maxLen small for large k.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define LIST_MAX        64              // Max #cycles stored by listCycles() to print them by printC()
+
+typedef char (*cycleFn)(const unsigned *c, const unsigned len, void *arg); // Gets each cycle; return non-zero to stop
+
+static TLS unsigned *cDist;             // Distance from node to the start node s, UINT_MAX if s cannot be reached
+static TLS unsigned *cPath, *cNext;     // Current walk, next node to try from each node in the walk
+static TLS unsigned *cQueue;            // BFS queue
+static TLS char     *cOnPath;           // cOnPath[gi] = 1 if node gi is in the current walk
+static TLS unsigned kCycMem;            // #centres the cycle memory is allocated for
+static TLS unsigned *Cl, NCl, lenCl;    // Cycles stored by listCycles(), #cycles stored, length of these cycles
+static TLS unsigned long long Ncl[LIST_MAX+1];  // #cycles found by listCycles() per length
+
+/** Allocate the memory to enumerate cycles, if not done yet for k centres
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char allocCycleMem()
+{
+    if (kCycMem >= k)
+        return 1;
+    free(cDist);
+    free(cPath);
+    free(cNext);
+    free(cQueue);
+    free(cOnPath);
+    free(Cl);
+    cDist   = (unsigned*)malloc(k * sizeof(unsigned));
+    cPath   = (unsigned*)malloc(k * sizeof(unsigned));
+    cNext   = (unsigned*)malloc(k * sizeof(unsigned));
+    cQueue  = (unsigned*)malloc(k * sizeof(unsigned));
+    cOnPath = (char*)calloc(k, sizeof(char));
+    Cl      = (unsigned*)malloc(LIST_MAX * k * sizeof(unsigned));
+    if (!cDist || !cPath || !cNext || !cQueue || !cOnPath || !Cl)
+    {
+        puts("Error allocating cycle mem");
+        kCycMem = 0;
+        return 0;
+    }
+    kCycMem = k;
+    return 1;
+}
+
+/** Set the distance from each node gi >= gs to node gs, walking over nodes >= gs only
+ * 261018 Created
+ * 261018 Clear the distances by a loop, not by memset() of a truncated UINT_MAX
+ */
+static void setDistTo(const unsigned gs)
+{
+    unsigned gi, gj, qh, qt;
+
+    for (gi = gs; gi < k; gi++)
+        cDist[gi] = UINT_MAX;
+    cDist[gs] = 0;
+    cQueue[0] = gs;
+    for (qh = 0, qt = 1; qh < qt; qh++)     // Walk backwards from gs
+    {
+        gj = cQueue[qh];
+        for (gi = gs; gi < k; gi++)
+            if ( (gi != gj) && W[gi][gj] && (cDist[gi] == UINT_MAX) ) // If edge (i,j) exists
+            {
+                cDist[gi] = cDist[gj] + 1;
+                cQueue[qt++] = gi;
+            }
+    }
+}
+
+/** Enumerate all elementary cycles of length <= maxLen in W and pass each of them to fn.
+ * A cycle c[0] -> c[1] -> ... -> c[len-1] -> c[0] is passed with c[0] its smallest node.
+ * Returns the #cycles passed to fn
+ * 261018 Created
+ */
+unsigned long long enumCycles(const unsigned maxLen, cycleFn fn, void *arg)
+{
+    unsigned gs, gi, gj, d;
+    unsigned long long cnt = 0;
+
+    if ( (maxLen < 2) || !allocCycleMem() )
+        return 0;
+    for (gs = 0; gs + 1 < k; gs++)
+    {
+        setDistTo(gs);
+        cPath[0] = gs;
+        cNext[0] = gs + 1;
+        cOnPath[gs] = 1;
+        for (d = 0; ; )                     // d: #edges in the walk gs -> .. -> cPath[d]
+        {
+            gi = cPath[d];
+            for (gj = cNext[d]; gj < k; gj++)
+                if ( W[gi][gj] && !cOnPath[gj] && (gj != gi) && (cDist[gj] != UINT_MAX) && (d + 1 + cDist[gj] <= maxLen) )
+                    break;
+            if (gj < k)                     // Take a step further in the walk
+            {
+                cNext[d] = gj + 1;
+                cPath[++d] = gj;
+                cNext[d] = gs + 1;
+                cOnPath[gj] = 1;
+                if (W[gj][gs])              // If a cycle has been walked
+                {
+                    cnt++;
+                    if (fn && fn(cPath, d + 1, arg))
+                    {
+                        for (; d; d--)
+                            cOnPath[cPath[d]] = 0;
+                        cOnPath[gs] = 0;
+                        return cnt;
+                    }
+                }
+            }
+            else                            // Take 1 step back
+            {
+                cOnPath[gi] = 0;
+                if (d == 0)
+                    break;
+                d--;
+            }
+        }
+    }
+
+    return cnt;
+}
+
+/** Count a cycle in the histogram arg
+ * 261018 Created
+ */
+static char countCycle(const unsigned *c, const unsigned len, void *arg)
+{
+    (void)c;
+    ((unsigned long long*)arg)[len]++;
+    return 0;
+}
+
+/** Get the histogram of the lengths of all elementary cycles of length <= maxLen:
+ * hist[len] = #cycles of length len, for len in [0, maxLen]
+ * Returns the total #cycles
+ * 261018 Created
+ */
+unsigned long long cycleLenHist(unsigned long long *hist, const unsigned maxLen)
+{
+    memset(hist, 0, (maxLen + 1) * sizeof(unsigned long long));
+    return enumCycles(maxLen, countCycle, hist);
+}
+
+/** Store a cycle of length lenCl for printC()
+ * 261018 Created
+ */
+static char storeCycle(const unsigned *c, const unsigned len, void *arg)
+{
+    (void)arg;
+    if (len != lenCl)
+        return 0;
+    if (NCl < LIST_MAX)
+        memcpy(&Cl[NCl * k], c, len * sizeof(unsigned));
+    NCl++;
+    return 0;
+}
+
+/** List the cycles of length len in W. The first LIST_MAX cycles are stored to print them by printC()
+ * Returns the #cycles of length len
+ * 261018 Created
+ */
+unsigned listCycles(const unsigned len)
+{
+    lenCl = len;
+    NCl   = 0;
+    enumCycles(len, storeCycle, NULL);
+    if (len <= LIST_MAX)
+        Ncl[len] = NCl;
+    return NCl;
+}
+
+/** Print the cycles listed by listCycles()
+ * 261018 Created
+ */
+void printC()
+{
+    unsigned ci, i;
+
+    printf("> %u cycles of length %u:\n", NCl, lenCl);
+    for (ci = 0; (ci < NCl) && (ci < LIST_MAX); ci++)
+    {
+        for (i = 0; i < lenCl; i++)
+            printf("%*u -> ", Nd, Cl[ci * k + i] + 1);
+        printf("%*u\n", Nd, Cl[ci * k] + 1);
+    }
+    if (NCl > LIST_MAX)
+        printf("  (%u more)\n", NCl - LIST_MAX);
+}
+
+/** Print the #cycles per length found by listCycles()
+ * 261018 Created
+ */
+void printNcLen()
+{
+    unsigned len;
+
+    printf("len #cycles\n");
+    for (len = 2; len <= LIST_MAX; len++)
+        if (Ncl[len])
+            printf("%3u %llu\n", len, Ncl[len]);
+}
+
+/** Remove a cycle from W
+ * 261018 Created
+ */
+static void removeCycle(const unsigned *c, const unsigned len)
+{
+    unsigned i;
+
+    for (i = 0; i + 1 < len; i++)
+        decW(c[i], c[i+1]);
+    decW(c[len-1], c[0]);
+}
+
+/** Remove the first cycle found
+ * 261018 Created
+ */
+static char peelCycle(const unsigned *c, const unsigned len, void *arg)
+{
+    (void)arg;
+    removeCycle(c, len);
+    return 1;                               // Stop; W has been changed
+}
+
+/** Peel the cycles off W, shortest cycles first, and count them
+ * Returns beta = #moves - #cycles, like getDecomp(). W is recovered afterwards.
+ * 261018 Created
+ */
+unsigned pealW()
+{
+    unsigned gi, len, beta = n;
+
+    for (gi = 0; gi < k; gi++)
+        beta -= W[gi][gi];                  // These qubits don't have to be moved
+    beta -= del2cycles();                   // Delete 2-cycles and count them
+    for (len = 3; (len <= k) && !emptyGraph(); )
+    {
+        if (enumCycles(len, peelCycle, NULL))
+            beta--;                         // +1 cycle removed; no shorter cycles can appear
+        else
+            len++;
+    }
+    setW();     // Recover W
+
+    return beta;
+}
+
+/** Print the degrees and weights of each node of W
+ * 261018 Created
+ * 261018 Print those kept by incW(), decW()
+ */
+void dbgW()
+{
+    unsigned gi;
+
+    printf("%*c | dOut dIn wOut wIn\n", Nd, 'c');
+    for (gi = 0; gi < k; gi++)
+        printf("%*u | %4u %3u %4u %3u\n", Nd, gi+1, outDeg[gi], inDeg[gi], outW[gi], inW[gi]);
+}
@@ -0,0 +1,76 @@
+/** Counters of the algorithmic operations per phase, to relate the work of an instance to its time
+ *
+ * The counters are only compiled in if OP_COUNT is defined; otherwise OP_INC(), OP_ADD() and
+ * OP_PHASE() are empty and cost nothing. OP_CYC() also traces the removal (trace.c). They are kept per thread; the pool threads add theirs
+ * to the thread that called parFor(). A batch resets them per instance (opReset()), stores them
+ * in the record of the instance (opStore()) and sums them over all instances.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+//#define OP_COUNT                      // Count the operations (see OC_*)
+
+enum {OC_BFS,                           // BFS runs (minCycleLenFrom(), shortestPaths(), delCycle())
+      OC_BFS_NODE,                      // Nodes expanded by a BFS
+      OC_BFS_SCAN,                      // Entries of W scanned by a BFS
+      OC_CYC2, OC_CYC3, OC_CYC4, OC_CYC5,   // Cycles removed of length 2, 3, 4, >= 5
+      OC_RESTART,                       // Restarts of delCycles() after a removal
+      OC_SPEC_REJ,                      // Walks of delCycles() ahead on the pool, dropped after a removal
+      OC_FB2, OC_FB5, OC_FB6,           // Fallbacks of getDecomp(): delCycle() with cond 2, 5, 6
+      OC_RULE_B, OC_RULE_C,             // Contractions of ruleB(), ruleC()
+      OC_SETW,                          // setW() calls
+      OC_SWAP_CHEAP, OC_SWAP_EXP,       // Swaps centre-leaf, centre-centre
+      NOC};
+enum {PH_ROUTE, PH_DECOMP, NPH};        // Phases: router, getDecomp()
+
+#ifdef OP_COUNT
+static const char *ocName[NOC] = {"bfs", "bfsNode", "bfsScan", "cyc2", "cyc3", "cyc4", "cyc5", "restart",
+                                  "specRej", "fb2", "fb5", "fb6", "ruleB", "ruleC", "setW", "swapCheap", "swapExp"};
+static const char *phName[NPH] = {"route", "decomp"};
+
+#define OP_INC(c)       (opCnt[opPhase][c]++)
+#define OP_ADD(c, v)    (opCnt[opPhase][c] += (v))
+#define OP_PHASE(p)     (opPhase = (p))
+#define OP_CYC(len)     (OP_INC((len) >= 5 ? OC_CYC5 : OC_CYC2 + (len) - 2), TR_CYCLE(len, 1))
+
+TLS unsigned long long opCnt[NPH][NOC]; // Counters of this thread
+TLS unsigned char      opPhase;         // Current phase: PH_*
+
+/** Reset the counters of this thread
+ * 261018 Created
+ */
+void opReset()
+{
+    memset(opCnt, 0, sizeof(opCnt));
+    opPhase = PH_ROUTE;
+}
+
+/** Store the counters of this thread in dst (NPH x NOC)
+ * 261018 Created
+ */
+void opStore(unsigned long long dst[NPH][NOC])
+{
+    memcpy(dst, opCnt, sizeof(opCnt));
+}
+
+/** Add the counters of all phases of this thread to dst (NOC), and reset them
+ * 261018 Created
+ */
+static void opDrain(unsigned long long *dst)
+{
+    unsigned p, c;
+
+    for (p = 0; p < NPH; p++)
+        for (c = 0; c < NOC; c++)
+        {
+            dst[c] += opCnt[p][c];
+            opCnt[p][c] = 0;
+        }
+}
+#else
+#define OP_INC(c)       ((void)0)
+#define OP_ADD(c, v)    ((void)0)
+#define OP_PHASE(p)     ((void)0)
+#define OP_CYC(len)     TR_CYCLE(len, 1)
+#endif // OP_COUNT
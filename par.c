@@ -0,0 +1,245 @@
+/** Work-stealing thread pool to run the independent analysis passes of one instance in parallel
+ *
+ * parFor(N, fn, ctx) runs fn(ctx, i, tid) for i in [0, N). Each thread starts with a contiguous
+ * range of i; a thread that runs out steals the upper half of the range of another thread.
+ * A range is one 64-bit word (lo, hi), so taking and stealing are single CAS operations.
+ * fn gets the thread index tid in [0, parN) to use per-thread scratch (parScratch()).
+ * The calling thread runs as tid 0. Results should be stored per i, so they can be reduced
+ * in the order of i, independent of the schedule.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define PAR_MAX         64              // Max #threads of the pool
+#define PAR_MIN_K       48              // Min #centres to run the analysis passes in parallel
+#define PAR_WALKS       4               // #start nodes per thread that delCycles() walks ahead from
+#define RANGE(lo, hi)   ((LONG64)(((unsigned long long)(hi) << 32) | (lo)))
+#define RANGE_LO(r)     ((unsigned)((unsigned long long)(r) & 0xFFFFFFFF))
+#define RANGE_HI(r)     ((unsigned)((unsigned long long)(r) >> 32))
+
+typedef void (*parFn)(void *ctx, const unsigned i, const unsigned tid);
+
+typedef struct
+{
+    volatile LONG64 range;              // Items [lo, hi) this thread has still to run
+    char     *buf;                      // Scratch buffer
+    size_t   bufSize;
+    char     pad[ARENA_ALIGN];          // Keep the ranges of the threads on different cache lines
+} parSlot;
+
+unsigned parN = 1;                      // #threads of the pool; 1: run the passes sequentially
+static parSlot  parSlots[PAR_MAX];
+static parFn    parF;                   // Job of the current generation
+static void     *parCtx;
+static unsigned parGen;                 // Generation: incremented by each parFor()
+static unsigned parBusy;                // #workers still running the current generation
+static char     parQuit;
+static CRITICAL_SECTION   parLock;      // Lock for parGen, parBusy, parQuit
+static CRITICAL_SECTION   parCall;      // Lock to run 1 parFor() at a time
+static CONDITION_VARIABLE parWake, parDone;
+static HANDLE   parTh[PAR_MAX];
+#ifdef OP_COUNT
+static unsigned long long parOps[NOC];  // Counters of the pool threads of the current generation
+#endif
+
+/** Get a scratch buffer of >= size bytes of thread tid. The buffer is kept for the next calls.
+ * Returns NULL if failed
+ * 261018 Created
+ */
+void *parScratch(const unsigned tid, const size_t size)
+{
+    parSlot *s = &parSlots[tid];
+
+    if (s->bufSize < size)
+    {
+        _aligned_free(s->buf);
+        s->bufSize = 0;
+        if ((s->buf = (char*)_aligned_malloc(ALIGN_UP(size), ARENA_ALIGN)) == NULL)
+            return NULL;
+        s->bufSize = ALIGN_UP(size);
+    }
+    return s->buf;
+}
+
+/** Take the next item of thread tid, or steal half of the items of another thread
+ * Returns 0 if no items are left
+ * 261018 Created
+ */
+static char parTake(const unsigned tid, unsigned *item)
+{
+    unsigned v, lo, hi, mid;
+    LONG64 r;
+    parSlot *s = &parSlots[tid];
+
+    for (;;)                                    // Take from the own range
+    {
+        r  = s->range;
+        lo = RANGE_LO(r);
+        hi = RANGE_HI(r);
+        if (lo >= hi)
+            break;
+        if (InterlockedCompareExchange64(&s->range, RANGE(lo + 1, hi), r) == r)
+        {
+            *item = lo;
+            return 1;
+        }
+    }
+    for (v = (tid + 1) % parN; v != tid; v = (v + 1) % parN)
+    {
+        for (;;)                                // Steal the upper half of the range of thread v
+        {
+            r  = parSlots[v].range;
+            lo = RANGE_LO(r);
+            hi = RANGE_HI(r);
+            if (lo >= hi)
+                break;
+            mid = lo + (hi - lo) / 2;
+            if (InterlockedCompareExchange64(&parSlots[v].range, RANGE(lo, mid), r) == r)
+            {
+                InterlockedExchange64(&s->range, RANGE(mid + 1, hi));
+                *item = mid;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/** Run items of the current job until none are left
+ * 261018 Created
+ */
+static void parRun(const unsigned tid)
+{
+    unsigned i;
+
+    while (parTake(tid, &i))
+        parF(parCtx, i, tid);
+}
+
+/** Pool thread: run the items of each generation
+ * 261018 Created
+ */
+static DWORD WINAPI parWorker(LPVOID arg)
+{
+    const unsigned tid = (unsigned)(size_t)arg;
+    unsigned gen = 0;
+
+    for (;;)
+    {
+        EnterCriticalSection(&parLock);
+        while ( (parGen == gen) && !parQuit )
+            SleepConditionVariableCS(&parWake, &parLock, INFINITE);
+        gen = parGen;
+        LeaveCriticalSection(&parLock);
+        if (parQuit)
+            return 0;
+
+        TR_BEGIN(TN_PAR, tid);
+        parRun(tid);
+        TR_END(TN_PAR);
+
+        EnterCriticalSection(&parLock);
+#ifdef OP_COUNT
+        opDrain(parOps);                // Hand the counters to the calling thread
+#endif
+        if (--parBusy == 0)
+            WakeConditionVariable(&parDone);
+        LeaveCriticalSection(&parLock);
+    }
+}
+
+/** Start a pool of T threads (0: 1/processor), including the calling thread
+ * Returns the #threads
+ * 261018 Created
+ */
+unsigned parStart(unsigned T)
+{
+    unsigned i;
+
+    if (T == 0)
+        T = getNcpu();
+    if (T > PAR_MAX)
+        T = PAR_MAX;
+    InitializeCriticalSection(&parLock);
+    InitializeCriticalSection(&parCall);
+    InitializeConditionVariable(&parWake);
+    InitializeConditionVariable(&parDone);
+    parQuit = 0;
+    for (parN = 1; parN < T; parN++)
+        if ((parTh[parN] = CreateThread(NULL, 0, parWorker, (LPVOID)(size_t)parN, 0, NULL)) == NULL)
+            break;
+    for (i = parN; i < T; i++)
+        parTh[i] = NULL;
+    return parN;
+}
+
+/** Stop the pool
+ * 261018 Created
+ */
+void parStop()
+{
+    unsigned i;
+
+    if (parN <= 1)
+        return;
+    EnterCriticalSection(&parLock);
+    parQuit = 1;
+    WakeAllConditionVariable(&parWake);
+    LeaveCriticalSection(&parLock);
+    for (i = 1; i < parN; i++)
+    {
+        WaitForSingleObject(parTh[i], INFINITE);
+        CloseHandle(parTh[i]);
+    }
+    for (i = 0; i < PAR_MAX; i++)
+    {
+        _aligned_free(parSlots[i].buf);
+        parSlots[i].buf = NULL;
+        parSlots[i].bufSize = 0;
+    }
+    DeleteCriticalSection(&parLock);
+    DeleteCriticalSection(&parCall);
+    parN = 1;
+}
+
+/** Run fn(ctx, i, tid) for i in [0, N) on the pool, and wait until all items are done
+ * 261018 Created
+ */
+void parFor(const unsigned N, parFn fn, void *ctx)
+{
+    unsigned t;
+
+    if (parN <= 1)
+    {
+        for (t = 0; t < N; t++)
+            fn(ctx, t, 0);
+        return;
+    }
+    EnterCriticalSection(&parCall);
+    parF   = fn;
+    parCtx = ctx;
+    for (t = 0; t < parN; t++)
+        parSlots[t].range = RANGE((unsigned long long)N * t / parN, (unsigned long long)N * (t + 1) / parN);
+
+    EnterCriticalSection(&parLock);
+    parBusy = parN - 1;
+    parGen++;
+    WakeAllConditionVariable(&parWake);
+    LeaveCriticalSection(&parLock);
+
+    parRun(0);
+
+    EnterCriticalSection(&parLock);
+    while (parBusy)
+        SleepConditionVariableCS(&parDone, &parLock, INFINITE);
+#ifdef OP_COUNT
+    for (t = 0; t < NOC; t++)
+    {
+        OP_ADD(t, parOps[t]);
+        parOps[t] = 0;
+    }
+#endif
+    LeaveCriticalSection(&parLock);
+    LeaveCriticalSection(&parCall);
+}
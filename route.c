@@ -0,0 +1,33 @@
+/** The algorithms to run on an instance, and the router to run by them
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define ALG_SIMPLE      1               // Run routeSimple()
+#define ALG_DECOMP      2               // Run getDecomp()
+#define ALG_STAGES      4               // Run routeStages()
+#define ALG_CYCLES      8               // Run routeCycles()
+#define ALG_ROUTE       (ALG_SIMPLE | ALG_STAGES | ALG_CYCLES)  // Routers; at most 1 per run
+
+/** Run the router of alg: routeSimple(), routeStages() or routeCycles()
+ * Returns beta if the router runs getDecomp() (routeCycles()), otherwise 0
+ * 261018 Created
+ * 261018 Trace the router as a span
+ */
+unsigned route(const char alg)
+{
+    unsigned beta = 0;
+    const unsigned char nm = (alg & ALG_CYCLES) ? TN_CYCLES : ((alg & ALG_STAGES) ? TN_STAGES : TN_SIMPLE);
+
+    (void)nm;
+    TR_BEGIN(nm, 0);
+    if (alg & ALG_CYCLES)
+        beta = routeCycles();
+    else if (alg & ALG_STAGES)
+        routeStages();
+    else if (alg & ALG_SIMPLE)
+        routeSimple();
+    TR_END(nm);
+    return beta;
+}
@@ -0,0 +1,513 @@
+/** Algorithm routeCycles to route the qubits from x to y along the cycle decomposition of getDecomp().
+ *
+ * While getDecomp() runs, its cycles and the contractions of ruleB() and ruleC() are logged in order.
+ * A contraction (a, b, c) replaces 1 move a -> b and 1 move b -> c by 1 move a -> c. Replaying the log
+ * expands the contracted moves of each cycle again, and a closed walk that visits a star twice is
+ * split up. This gives the cycles of G' as a compact store: the stars of cycle ci are
+ * cycS[cycOff[ci]], ..., cycS[cycOff[ci+1]-1], where star s has a label for the next star.
+ *
+ * A cycle a(0) -> .. -> a(L-1) is routed in <= 3 stages:
+ *   0. Each centre a(p) gets a label for a(p+1) from a leaf, if it does not have one yet (cheap swaps).
+ *   1. The centres a(p), a(L-p) are swapped, for p in [1, (L-1)/2].
+ *   2. The centres a(0), a(1) and a(p), a(L+1-p) are swapped, for p in [2, L/2].
+ * Stages 1 and 2 are reflections that shift the labels along the cycle, using L-1 expensive swaps.
+ * Which centres they swap depends on the start a(0) of the cycle; if centre swaps cost per star
+ * pair (cost.c), the cycle is rotated to the start of which the reflections cost least.
+ * Cycles without common stars are routed in the same stages.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define EV_CONTRACT     0               // Tag of a contraction in the event log
+#define NO_UNIT         UINT_MAX        // Original move, not a contracted one
+
+typedef struct
+{
+    unsigned b;                         // Contracted move a -> c = move a -> b + move b -> c
+    unsigned left, right;               // Units of the moves a -> b, b -> c; NO_UNIT if original
+    unsigned next;                      // Next contracted unit of the same move (stack)
+} cUnit;
+
+TLS unsigned *cycS, *cycOff;            // Cycle store: stars of the cycles, offset of each cycle
+TLS unsigned Ncyc;                      // #cycles in the store
+static TLS size_t   cycSCap, cycOffCap;
+static TLS unsigned *evLog;             // Events of getDecomp(): L s(0) .. s(L-1) | EV_CONTRACT a b c
+static TLS size_t   NevLog, evLogCap;
+static TLS unsigned NcontrLog;          // #contractions logged
+static TLS cUnit    *cu;                // Contracted units
+static TLS unsigned Ncu;
+static TLS unsigned long long *hKey;    // Hash table: move a -> c (a*k + c) -> top of the stack of its units
+static TLS unsigned *hTop;
+static TLS unsigned hMask;
+static TLS size_t   cuCap, hKeyCap, hTopCap;
+static TLS unsigned *walk, *wStack;     // Closed walk of a cycle, stack to expand units / split the walk
+static TLS int      *wPos;              // wPos[s] = index of star s in wStack, -1 if not there
+static TLS size_t   walkCap, wStackCap;
+static TLS unsigned kWalk;              // #centres wPos is allocated for
+
+/** Start logging the cycles and contractions of getDecomp()
+ * 261018 Created
+ */
+static void startCycleLog()
+{
+    NevLog    = 0;
+    NcontrLog = 0;
+    cycRec    = 1;
+}
+
+/** Log a cycle of len stars removed from W. If rev, c[0] <- c[1] <- .. <- c[len-1] <- c[0] is logged.
+ * 261018 Created
+ */
+void logCycle(const unsigned *c, const unsigned len, const char rev)
+{
+    unsigned i;
+
+    if (!growBuf((void**)&evLog, &evLogCap, NevLog + len + 1, sizeof(unsigned)))
+    {
+        anomaly(ERR_NO_MEM, "! Cycle log: out of memory\n");
+        cycRec = 0;
+        return;
+    }
+    evLog[NevLog++] = len;
+    evLog[NevLog++] = c[0];
+    for (i = 1; i < len; i++)
+        evLog[NevLog++] = rev ? c[len - i] : c[i];
+}
+
+/** Log a contraction of the moves a -> b, b -> c into a -> c
+ * 261018 Created
+ */
+void logContract(const unsigned a, const unsigned b, const unsigned c)
+{
+    if (!growBuf((void**)&evLog, &evLogCap, NevLog + 4, sizeof(unsigned)))
+    {
+        anomaly(ERR_NO_MEM, "! Cycle log: out of memory\n");
+        cycRec = 0;
+        return;
+    }
+    evLog[NevLog++] = EV_CONTRACT;
+    evLog[NevLog++] = a;
+    evLog[NevLog++] = b;
+    evLog[NevLog++] = c;
+    NcontrLog++;
+}
+
+/** Get the slot of move a -> c in the hash table. If add, a missing move is added.
+ * Returns NO_UNIT if the move is missing and not added
+ * 261018 Created
+ */
+static unsigned hSlot(const unsigned a, const unsigned c, const char add)
+{
+    const unsigned long long key = (unsigned long long)a * k + c;
+    unsigned h = (unsigned)((key * 0x9E3779B97F4A7C15ULL) >> 32) & hMask;
+
+    while ( (hKey[h] != key) && (hKey[h] != ULLONG_MAX) )
+        h = (h + 1) & hMask;
+    if (hKey[h] == ULLONG_MAX)
+    {
+        if (!add)
+            return NO_UNIT;
+        hKey[h] = key;
+        hTop[h] = NO_UNIT;
+    }
+    return h;
+}
+
+/** Take a unit of move a -> c: the last contracted unit, or NO_UNIT (an original move) if there is none
+ * 261018 Created
+ */
+static unsigned takeUnit(const unsigned a, const unsigned c)
+{
+    unsigned h, u;
+
+    if ( (NcontrLog == 0) || ((h = hSlot(a, c, 0)) == NO_UNIT) )
+        return NO_UNIT;
+    u = hTop[h];
+    if (u != NO_UNIT)
+        hTop[h] = cu[u].next;
+    return u;
+}
+
+/** Append star s to the walk
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char walkAdd(size_t *len, const unsigned s)
+{
+    if (!growBuf((void**)&walk, &walkCap, *len + 1, sizeof(unsigned)))
+        return 0;
+    walk[(*len)++] = s;
+    return 1;
+}
+
+/** Append the stars between a and c of unit u of move a -> c to the walk
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char walkUnit(size_t *len, unsigned u)
+{
+    size_t top = 0;
+
+    while ( (u != NO_UNIT) || top )             // In-order walk over the tree of contractions
+    {
+        while (u != NO_UNIT)
+        {
+            if (!growBuf((void**)&wStack, &wStackCap, top + 1, sizeof(unsigned)))
+                return 0;
+            wStack[top++] = u;
+            u = cu[u].left;
+        }
+        u = wStack[--top];
+        if (!walkAdd(len, cu[u].b))
+            return 0;
+        u = cu[u].right;
+    }
+    return 1;
+}
+
+/** Store the cycle s[0] -> .. -> s[len-1] -> s[0]
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char storeCycleS(const unsigned *s, const unsigned len)
+{
+    const size_t off = cycOff[Ncyc];
+
+    if ( !growBuf((void**)&cycS, &cycSCap, off + len, sizeof(unsigned))
+            || !growBuf((void**)&cycOff, &cycOffCap, Ncyc + 2, sizeof(unsigned)) )
+        return 0;
+    memcpy(&cycS[off], s, len * sizeof(unsigned));
+    cycOff[++Ncyc] = off + len;
+    return 1;
+}
+
+/** Split the closed walk of len stars into cycles and store them
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char splitWalk(const size_t len)
+{
+    size_t i, top = 0, j;
+    unsigned s;
+
+    if (!growBuf((void**)&wStack, &wStackCap, len, sizeof(unsigned)))
+        return 0;
+    for (i = 0; i < len; i++)
+    {
+        s = walk[i];
+        if (wPos[s] >= 0)                       // Star s visited again: store the cycle from s
+        {
+            j = wPos[s];
+            if (!storeCycleS(&wStack[j], top - j))
+                return 0;
+            while (top > j + 1)
+                wPos[wStack[--top]] = -1;
+            continue;
+        }
+        wPos[s] = top;
+        wStack[top++] = s;
+    }
+    if ( (top >= 2) && !storeCycleS(wStack, top) )
+        return 0;
+    while (top)
+        wPos[wStack[--top]] = -1;
+    return 1;
+}
+
+/** Replay the event log: expand the contracted moves of the logged cycles and store the cycles
+ * Returns 0 if failed
+ * 261018 Created
+ * 261018 Keep the hash table and units between instances
+ */
+static char expandCycles()
+{
+    size_t e, len;
+    unsigned L, i, a, b, c, h, u, s;
+
+    if (kWalk < k)
+    {
+        free(wPos);
+        if ((wPos = (int*)malloc(k * sizeof(int))) == NULL)
+            return 0;
+        kWalk = k;
+    }
+    memset(wPos, -1, k * sizeof(int));
+    Ncu = 0;
+    for (hMask = 1; hMask < 2 * NcontrLog + 2; hMask *= 2);
+    if (!growBuf((void**)&cycOff, &cycOffCap, 1, sizeof(unsigned)))
+        return 0;
+    if ( !growBuf((void**)&hKey, &hKeyCap, hMask, sizeof(unsigned long long))
+            || !growBuf((void**)&hTop, &hTopCap, hMask, sizeof(unsigned))
+            || !growBuf((void**)&cu, &cuCap, NcontrLog + 1, sizeof(cUnit)) )
+        return 0;
+    memset(hKey, 0xFF, hMask * sizeof(unsigned long long));
+    hMask--;
+    Ncyc = 0;
+    cycOff[0] = 0;
+
+    for (e = 0; e < NevLog; e += (L ? L : 3) + 1)
+    {
+        L = evLog[e];
+        if (L == EV_CONTRACT)
+        {
+            a = evLog[e+1];
+            b = evLog[e+2];
+            c = evLog[e+3];
+            u = Ncu++;
+            cu[u].b     = b;
+            cu[u].left  = takeUnit(a, b);
+            cu[u].right = takeUnit(b, c);
+            h = hSlot(a, c, 1);
+            cu[u].next  = hTop[h];
+            hTop[h]     = u;
+            continue;
+        }
+        len = 0;
+        for (i = 0; i < L; i++)
+        {
+            s = evLog[e+1+i];
+            if ( !walkAdd(&len, s) || !walkUnit(&len, takeUnit(s, evLog[e+1+(i+1)%L])) )
+                return 0;
+        }
+        if (!splitWalk(len))
+            return 0;
+    }
+    return 1;
+}
+
+static TLS unsigned *cOrder;            // Cycles in order of priority
+static TLS unsigned *cAct, *cPhase;     // Cycles being routed, their next stage (0, 1, 2)
+static TLS char     *cBusy;             // cBusy[g] = 1 if star g is in a cycle being routed
+static TLS unsigned *cLoad;             // #cycles per star
+static TLS size_t   cOrderCap, cActCap, cPhaseCap;
+static TLS unsigned kCycRoute;          // #centres cBusy, cLoad are allocated for
+
+/** Get the priority of cycle ci: the max #cycles of its stars, then its length
+ * 261018 Created
+ */
+static unsigned long long cycPrio(const unsigned ci)
+{
+    unsigned p, load = 0;
+
+    for (p = cycOff[ci]; p < cycOff[ci+1]; p++)
+        if (cLoad[cycS[p]] > load)
+            load = cLoad[cycS[p]];
+    return ((unsigned long long)load << 32) | (cycOff[ci+1] - cycOff[ci]);
+}
+
+/** Compare cycles by their priority, highest first
+ * 261018 Created
+ */
+static int cmpCycPrio(const void *a, const void *b)
+{
+    const unsigned ca = *(const unsigned*)a, cb = *(const unsigned*)b;
+    const unsigned long long pa = cycPrio(ca), pb = cycPrio(cb);
+
+    if (pa != pb)
+        return pa < pb ? 1 : -1;
+    return ca < cb ? -1 : 1;
+}
+
+/** Swap the labels of nodes i, j in this stage and update the statistics
+ * 261018 Created
+ */
+static void cycSwap(const unsigned i, const unsigned j)
+{
+    const unsigned l = LAB(x, i);
+
+    SET_LAB(x, i, LAB(x, j));
+    SET_LAB(x, j, l);
+    Ns++;
+    if ( isC(i) && isC(j) )
+        Nsb++;                          // Centre-centre swap
+    recSwap(i, j);
+}
+
+/** Do the swaps of stage ph of cycle ci
+ * Returns the #swaps done
+ * 261018 Created
+ */
+static unsigned cycStage(const unsigned ci, const unsigned ph)
+{
+    const unsigned *a = &cycS[cycOff[ci]];
+    const unsigned L = cycOff[ci+1] - cycOff[ci];
+    unsigned p, l, Nsw = 0;
+
+    switch (ph)
+    {
+    case 0:                             // Get the labels into the centres
+        for (p = 0; p < L; p++)
+        {
+            if (destOf(a[p]*(m+1)) == a[(p+1)%L])
+                continue;
+            for (l = 1; (l <= m) && (destOf(a[p]*(m+1) + l) != a[(p+1)%L]); l++);
+            if ( (l > m) && anomaly(ERR_NO_LABEL, "! rCy: star %u has no label for star %u\n", a[p]+1, a[(p+1)%L]+1) )
+                return Nsw;
+            if (l <= m)
+            {
+                cycSwap(a[p]*(m+1), a[p]*(m+1) + l);
+                Nsw++;
+            }
+        }
+        break;
+    case 1:                             // Reflection p <-> -p
+        for (p = 1; 2*p < L; p++, Nsw++)
+            cycSwap(a[p]*(m+1), a[L-p]*(m+1));
+        break;
+    case 2:                             // Reflection p <-> 1-p
+        cycSwap(a[0]*(m+1), a[1]*(m+1));
+        for (p = 2, Nsw = 1; 2*p <= L; p++, Nsw++)
+            cycSwap(a[p]*(m+1), a[L+1-p]*(m+1));
+    }
+    return Nsw;
+}
+
+/** Reverse the stars a[0], .., a[N-1]
+ * 261018 Created
+ */
+static void revStars(unsigned *a, const unsigned N)
+{
+    unsigned i, t;
+
+    for (i = 0; 2*i + 1 < N; i++)
+    {
+        t        = a[i];
+        a[i]     = a[N-1-i];
+        a[N-1-i] = t;
+    }
+}
+
+/** Rotate cycle ci to the start a(0) of which its reflections cost least under the cost model:
+ * the costs of their centre swaps, plus the most expensive one of each reflection (its stage)
+ * 261018 Created
+ */
+static void cycAxis(const unsigned ci)
+{
+    unsigned *a = &cycS[cycOff[ci]];
+    const unsigned L = cycOff[ci+1] - cycOff[ci];
+    unsigned r, p, c, best = 0;
+    unsigned long long sum, max1, max2, bestSum = ULLONG_MAX;
+
+    if (L < 3)
+        return;                         // 1 centre swap
+    for (r = 0; r < L; r++)
+    {
+        for (p = 1, sum = 0, max1 = 0; 2*p < L; p++)
+        {
+            c    = costPair(a[(r+p) % L], a[(r+L-p) % L]);
+            sum += c;
+            max1 = c > max1 ? c : max1;
+        }
+        max2 = costPair(a[r], a[(r+1) % L]);
+        for (p = 2, sum += max2; 2*p <= L; p++)
+        {
+            c    = costPair(a[(r+p) % L], a[(r+L+1-p) % L]);
+            sum += c;
+            max2 = c > max2 ? c : max2;
+        }
+        if (sum + max1 + max2 < bestSum)
+        {
+            bestSum = sum + max1 + max2;
+            best    = r;
+        }
+    }
+    revStars(a, best);                  // Rotate a by best
+    revStars(a + best, L - best);
+    revStars(a, L);
+}
+
+/** Route x to y along the cycles of the decomposition of getDecomp(), routing cycles
+ * without common stars in the same stages.
+ * Returns beta of getDecomp()
+ * 261018 Created
+ * 261018 Start each cycle at its cheapest axis, if centre swaps cost per star pair
+ */
+unsigned routeCycles()
+{
+    unsigned beta, ci, i, p, Npend, Nact, Nsw;
+
+    setX();
+    setW();
+    startCycleLog();
+    beta = getDecomp();
+    cycRec = 0;
+    if (GIVE_UP)
+        return beta;
+    if (!expandCycles())
+    {
+        anomaly(ERR_NO_MEM, "! rCy: out of memory\n");
+        return beta;
+    }
+
+    newRound();
+    costBind();
+    if (!allocStageMem())
+        return beta;
+    memset(dStar, 0, (n + 1) * sizeof(unsigned));
+    for (i = 0; i < n; i++)
+        dStar[LAB(y, i)] = i/(m+1);
+    if (kCycRoute < k)
+    {
+        free(cBusy);
+        free(cLoad);
+        cBusy = (char*)malloc(k * sizeof(char));
+        cLoad = (unsigned*)malloc(k * sizeof(unsigned));
+        kCycRoute = (cBusy && cLoad) ? k : 0;
+    }
+    if ( !kCycRoute || !growBuf((void**)&cOrder, &cOrderCap, Ncyc + 1, sizeof(unsigned))
+            || !growBuf((void**)&cAct, &cActCap, Ncyc + 1, sizeof(unsigned))
+            || !growBuf((void**)&cPhase, &cPhaseCap, Ncyc + 1, sizeof(unsigned)) )
+    {
+        anomaly(ERR_NO_MEM, "! rCy: out of memory\n");
+        return beta;
+    }
+    memset(cBusy, 0, k * sizeof(char));
+    memset(cLoad, 0, k * sizeof(unsigned));
+    for (p = 0; p < cycOff[Ncyc]; p++)
+        cLoad[cycS[p]]++;
+    for (ci = 0; ci < Ncyc; ci++)
+        cOrder[ci] = ci;
+    qsort(cOrder, Ncyc, sizeof(unsigned), cmpCycPrio);
+
+    for (Npend = Ncyc, Nact = 0; (Npend || Nact) && !GIVE_UP; )
+    {
+        depth++;
+        TR_STAGE();
+        // Start the cycles of which all stars are free, in order of priority
+        for (i = 0, ci = 0; i < Npend; i++)
+        {
+            for (p = cycOff[cOrder[i]]; (p < cycOff[cOrder[i]+1]) && !cBusy[cycS[p]]; p++);
+            if (p < cycOff[cOrder[i]+1])
+            {
+                cOrder[ci++] = cOrder[i];   // Keep it pending
+                continue;
+            }
+            for (p = cycOff[cOrder[i]]; p < cycOff[cOrder[i]+1]; p++)
+                cBusy[cycS[p]] = 1;
+            if (costB != NULL)
+                cycAxis(cOrder[i]);
+            cAct[Nact]     = cOrder[i];
+            cPhase[Nact++] = 0;
+        }
+        Npend = ci;
+
+        // Do the next stage of each cycle being routed
+        for (i = 0, ci = 0; i < Nact; i++)
+        {
+            for (Nsw = 0; (cPhase[i] <= 2) && !Nsw; cPhase[i]++)
+                Nsw = cycStage(cAct[i], cPhase[i]);     // Skip stages without swaps
+            if (cPhase[i] <= 2)
+            {
+                cAct[ci]     = cAct[i];
+                cPhase[ci++] = cPhase[i];
+                continue;
+            }
+            for (p = cycOff[cAct[i]]; p < cycOff[cAct[i]+1]; p++)
+                cBusy[cycS[p]] = 0;         // Free from the next stage on
+        }
+        Nact = ci;
+    }
+
+    return beta;
+}
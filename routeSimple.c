@@ -26,7 +26,7 @@ unsigned isC(const unsigned j)
  */
 char swap(const unsigned i, const unsigned j)
 {
-    const unsigned tmp = x[i];
+    const unsigned tmp = LAB(x, i);
     const unsigned gi = i/(m+1);
     const unsigned gj = j/(m+1);
 
@@ -36,8 +36,8 @@ char swap(const unsigned i, const unsigned j)
         return 0;
 
     // Swap qubits
-    x[i] = x[j];
-    x[j] = tmp;
+    SET_LAB(x, i, LAB(x, j));
+    SET_LAB(x, j, tmp);
 #ifdef PRINT_SWAPS
     // Print the swap done
     if (isC(j))
@@ -45,7 +45,7 @@ char swap(const unsigned i, const unsigned j)
         printf("%*u", Nd, i+1);
 #ifdef PRINT_NUM
         COLOR_NUM;
-        printf("(%*u)", Nd, x[i]+1);
+        printf("(%*u)", Nd, LAB(x, i)+1);
 #endif // PRINT_NUM
         COLOR_TEXT;         // 170417
         printf("-");
@@ -53,7 +53,7 @@ char swap(const unsigned i, const unsigned j)
 #ifdef PRINT_NUM
         printf("%*u", Nd, j+1);
         COLOR_NUM;
-        printf("(%*u) ", Nd, x[j]+1);
+        printf("(%*u) ", Nd, LAB(x, j)+1);
         NORMAL_TEXT;
 #else
         printf("%*u ", Nd, j+1);
@@ -64,11 +64,11 @@ char swap(const unsigned i, const unsigned j)
 #ifdef PRINT_NUM
         printf("%*u", Nd, i+1);
         COLOR_NUM;
-        printf("(%*u)", Nd, x[i]+1);
+        printf("(%*u)", Nd, LAB(x, i)+1);
         NORMAL_TEXT;
         printf("-%*u", Nd, j+1);
         COLOR_NUM;
-        printf("(%*u) ", Nd, x[j]+1);
+        printf("(%*u) ", Nd, LAB(x, j)+1);
         NORMAL_TEXT;
 #else
         printf("%*u-%*u ", Nd, i+1, Nd, j+1);
@@ -80,6 +80,7 @@ char swap(const unsigned i, const unsigned j)
         Nsb++;                      // One expensive swap done
     }
 
+    recSwap(i, j);
     c2use[i/(m+1)] = BEING_USED;    // This centre is swapped now; it cannot be used in this stage
     c2use[j/(m+1)] = BEING_USED;    // This centre is swapped now
     Ns++;                           // Increase swap counter
@@ -88,14 +89,14 @@ char swap(const unsigned i, const unsigned j)
     {
         if (W[i/(m+1)][i/(m+1)] == m + 1) // If all numbers are in group Gi
         {
-            if (isC(x[i]))          // If this centre has the right number
+            if (isC(LAB(x, i)))          // If this centre has the right number
                 c2use[i/(m+1)] = SORTED;
             else
                 c2use[i/(m+1)] = CORRECT | BEING_USED;
         }
         if (W[j/(m+1)][j/(m+1)] == m + 1) // If all numbers are in group Gj
         {
-            if (isC(x[j]))          // If this centre has the right number
+            if (isC(LAB(x, j)))          // If this centre has the right number
                 c2use[j/(m+1)] = SORTED;
             else
                 c2use[j/(m+1)] = CORRECT | BEING_USED;
@@ -161,10 +162,11 @@ static char setOut(const unsigned gi)
 /** This is a trivial sorting algorithm
  * which firstly places all numbers in the first group, then in the second, etc.
  * 170520 Created
+ * 261018 Do not count a last stage without swaps
  */
 void routeSimple()
 {
-    unsigned gi, gj, si, sj;
+    unsigned gi, gj, si, sj, Ns0;
 
 #ifdef PRINT_SWAPS
     puts("RouteSimple is solving the problem...");
@@ -189,7 +191,7 @@ void routeSimple()
                 newStage();                 // Begin a new stage
             //doS(gi, gj);            // Do the swap
             swap(gi*(m+1), gj*(m+1));       // Do the swap
-            while (W[gj][gi])               // While Gj has numbers for Gi
+            while (W[gj][gi] && !GIVE_UP)   // While Gj has numbers for Gi
             {
                 newStage();                 // Bring a number from Gj to Gi
                 setOut(gi);                 // Swap such that dest(xi) != Gi
@@ -201,7 +203,10 @@ void routeSimple()
         }
     }
 
+    Ns0 = Ns;
     newStage();
+    if (Ns == Ns0)
+        depth--;                    // No swaps in the last stage
     //finalize(); // Set all centres correctly
 #ifdef SAVE_DATA
     fclose(fsol);
@@ -0,0 +1,214 @@
+/** Algorithm routeStages to route the qubits from x to y, like routeSimple(), to the star level,
+ * with the swaps of many star pairs in the same stage.
+ *
+ * Each stage is a matching of disjoint swaps: each centre is in at most 1 swap.
+ * The stars are handled in order of their remaining work (#labels to move out + in):
+ *   1. Centres that hold each other's labels are swapped (2 labels get home).
+ *   2. A centre holding a label for star h waits for h to move a leaf label for it into
+ *      its centre (cheap swap), so both centres can be swapped in the next stage.
+ *      If h has no such leaf, the centres are swapped now (1 label gets home).
+ *   3. A centre holding a label of its own star gets a leaf label that has to move out,
+ *      preferably one for a star whose centre holds a label for this star.
+ * A label never leaves its destination star again, so the router ends.
+ * W is kept up to date per swap (incW(), decW()) instead of by setW().
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+static TLS unsigned *dStar;             // dStar[l] = destination star of label l
+static TLS unsigned *sOrder;            // Stars in order of remaining work
+static TLS unsigned *sWork;             // Remaining work per star: #labels to move out + in
+static TLS char     *sUsed;             // sUsed[g] = 1 if centre g is in a swap of this stage
+static TLS unsigned nStageMem, kStageMem;   // #nodes, #centres the memory is allocated for
+
+/** Allocate the memory of routeStages(), if not done yet for n nodes and k centres
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char allocStageMem()
+{
+    if ( (nStageMem >= n) && (kStageMem >= k) )
+        return 1;
+    free(dStar);
+    free(sOrder);
+    free(sWork);
+    free(sUsed);
+    dStar  = (unsigned*)malloc((n + 1) * sizeof(unsigned));
+    sOrder = (unsigned*)malloc(k * sizeof(unsigned));
+    sWork  = (unsigned*)malloc(k * sizeof(unsigned));
+    sUsed  = (char*)malloc(k * sizeof(char));
+    if (!dStar || !sOrder || !sWork || !sUsed)
+    {
+        puts("Error allocating stage mem");
+        nStageMem = kStageMem = 0;
+        return 0;
+    }
+    nStageMem = n;
+    kStageMem = k;
+    return 1;
+}
+
+/** Get the destination star of the label at node j
+ * 261018 Created
+ */
+static inline unsigned destOf(const unsigned j)
+{
+    return dStar[LAB(x, j)];
+}
+
+/** Move a label for star d from star from to star to in W and in the work per star
+ * 261018 Created
+ */
+static void moveLabel(const unsigned from, const unsigned to, const unsigned d)
+{
+    decW(from, d);
+    incW(to, d);
+    if (d != from)
+    {
+        sWork[from]--;
+        sWork[d]--;
+    }
+    if (d != to)
+    {
+        sWork[to]++;
+        sWork[d]++;
+    }
+}
+
+/** Swap the labels of nodes i, j in this stage and update W, the work and the statistics
+ * 261018 Created
+ */
+static void stageSwap(const unsigned i, const unsigned j)
+{
+    const unsigned gi = i/(m+1), gj = j/(m+1);
+    const unsigned li = LAB(x, i), lj = LAB(x, j);
+
+    SET_LAB(x, i, lj);
+    SET_LAB(x, j, li);
+    sUsed[gi] = 1;
+    sUsed[gj] = 1;
+    Ns++;
+    recSwap(i, j);
+    if (gi == gj)
+        return;                         // Centre-leaf swap: the labels stay in the star
+    Nsb++;                              // Centre-centre swap
+    moveLabel(gi, gj, dStar[li]);
+    moveLabel(gj, gi, dStar[lj]);
+}
+
+/** Get a leaf of star g with a label for star h, or 0 if there is none
+ * 261018 Created
+ */
+static unsigned leafFor(const unsigned g, const unsigned h)
+{
+    unsigned l;
+    const unsigned c = g*(m+1);
+
+    for (l = 1; l <= m; l++)
+        if (destOf(c + l) == h)
+            return l;
+    return 0;
+}
+
+/** Compare stars by their remaining work, most work first
+ * 261018 Created
+ */
+static int cmpWork(const void *a, const void *b)
+{
+    const unsigned ga = *(const unsigned*)a, gb = *(const unsigned*)b;
+
+    if (sWork[ga] != sWork[gb])
+        return sWork[ga] < sWork[gb] ? 1 : -1;
+    return ga < gb ? -1 : 1;
+}
+
+/** Route x to y on the star level, building each stage as a matching of disjoint swaps
+ * 261018 Created
+ */
+void routeStages()
+{
+    unsigned i, gi, gj, g, h, l, Nact, Nleft, Ns0;
+    unsigned cg, ch;                    // Leaf of star g, h
+
+    newRound();
+    if (!allocStageMem())
+        return;
+    memset(dStar, 0, (n + 1) * sizeof(unsigned));
+    for (i = 0; i < n; i++)
+        dStar[LAB(y, i)] = i/(m+1);
+    for (gi = 0; gi < k; gi++)
+    {
+        sWork[gi] = 0;
+        for (gj = 0; gj < k; gj++)
+            if (gj != gi)
+                sWork[gi] += W[gi][gj] + W[gj][gi];
+    }
+    for (Nleft = 0, gi = 0; gi < k; gi++)
+        Nleft += sWork[gi];
+
+    while (Nleft && !GIVE_UP)
+    {
+        // Order the stars with work by their remaining work
+        for (Nact = 0, gi = 0; gi < k; gi++)
+            if (sWork[gi])
+                sOrder[Nact++] = gi;
+        qsort(sOrder, Nact, sizeof(unsigned), cmpWork);
+        memset(sUsed, 0, k * sizeof(char));
+        depth++;
+        TR_STAGE();
+        Ns0 = Ns;
+
+        // 1. Centres holding each other's labels
+        for (l = 0; l < Nact; l++)
+        {
+            g = sOrder[l];
+            h = destOf(g*(m+1));
+            if ( !sUsed[g] && (h != g) && !sUsed[h] && (destOf(h*(m+1)) == g) )
+                stageSwap(g*(m+1), h*(m+1));
+        }
+        // 2. Centres holding a label for another star h
+        for (l = 0; l < Nact; l++)
+        {
+            g = sOrder[l];
+            h = destOf(g*(m+1));
+            if ( sUsed[g] || (h == g) || sUsed[h] )
+                continue;
+            if ((ch = leafFor(h, g)) != 0)
+                stageSwap(h*(m+1), h*(m+1) + ch);   // Bring a label for g into centre h; g waits
+            else if (destOf(h*(m+1)) != h)
+                stageSwap(g*(m+1), h*(m+1));
+        }
+        // 3. Centres holding a label of their own star
+        for (l = 0; l < Nact; l++)
+        {
+            g = sOrder[l];
+            if ( sUsed[g] || (destOf(g*(m+1)) != g) )
+                continue;
+            cg = 0;
+            for (i = 1; i <= m; i++)        // Prefer a label for a star whose centre holds a label for g
+            {
+                h = destOf(g*(m+1) + i);
+                if (h == g)
+                    continue;
+                if (cg == 0)
+                    cg = i;
+                if ( !sUsed[h] && (destOf(h*(m+1)) == g) )
+                {
+                    cg = i;
+                    break;
+                }
+            }
+            if (cg)
+                stageSwap(g*(m+1), g*(m+1) + cg);
+        }
+
+        if (Ns == Ns0)
+        {
+            anomaly(ERR_NO_SWAP, "! rSt: no swap in stage %u\n", depth);
+            break;
+        }
+        for (Nleft = 0, gi = 0; gi < k; gi++)
+            Nleft += sWork[gi];
+    }
+}
@@ -0,0 +1,416 @@
+/** The library API of routeSwaps.h on top of the solver
+ *
+ * A solver handle only holds its problem and budget; the solver buffers are those of the thread
+ * (TLS), set up again by rsSolve() if the thread last solved another problem. The labels of an
+ * instance are copied into the solver state; the schedule is recorded straight into the buffer of
+ * the caller (rsSwap has the layout of swapRec), so no result is copied.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#include "routeSwaps.h"
+
+struct rsSolver
+{
+    unsigned k, m, n;
+    unsigned long long budgetNs, budgetOps;     // Budget of getDecomp(); 0: no limit
+    costModel *cost;                    // Swap-cost model; NULL: costDefault
+};
+
+typedef char rsSwapIsSwapRec[(sizeof(rsSwap) == sizeof(swapRec)) ? 1 : -1];   // Record into rsSwap buffers
+
+#define RS_AT(a, i)     ((void*)((char*)(a) + (size_t)(i) * (a)->size))   // Element i of an array of the caller
+
+static TLS char     *rsSeen;            // rsSeen[l-1] = 1 if label l is in the vector checked
+static TLS unsigned rsSeenCap;
+
+/** Get the API version of the library
+ * 261018 Created
+ */
+RS_API uint32_t rsVersion(void)
+{
+    return RS_API_VERSION;
+}
+
+/** Create a solver for kk centres with mm leafs each, and set up its buffers on this thread
+ * Returns NULL if failed
+ * 261018 Created
+ */
+RS_API rsSolver *rsCreate(uint32_t kk, uint32_t mm)
+{
+    rsSolver *s;
+
+    if ((s = (rsSolver*)calloc(1, sizeof(rsSolver))) == NULL)
+        return NULL;
+    pauseOnErr = 0;                     // Answer anomalies by a status, never pause
+    if (!setProblem(kk, mm))
+    {
+        free(s);
+        return NULL;
+    }
+    s->k = k;
+    s->m = m;
+    s->n = n;
+    return s;
+}
+
+/** Destroy solver s. The solver buffers of this thread are kept for the other solvers it uses.
+ * 261018 Created
+ * 261018 Release the lane buffers
+ * 261018 Release the buffers of this thread in rsThreadCleanup() instead
+ */
+RS_API void rsDestroy(rsSolver *s)
+{
+    if (s != NULL)
+        costFree(s->cost);
+    costUse(NULL);
+    free(s);
+}
+
+/** Release the solver buffers of this thread
+ * 261018 Created from rsDestroy()
+ */
+RS_API void rsThreadCleanup(void)
+{
+    freeMem();
+    laneFree();
+    free(rsSeen);
+    rsSeen    = NULL;
+    rsSeenCap = 0;
+}
+
+/** Get the #nodes of the problem of solver s
+ * 261018 Created
+ */
+RS_API uint32_t rsNodes(const rsSolver *s)
+{
+    return s ? s->n : 0;
+}
+
+/** Set the budget of getDecomp() of solver s
+ * 261018 Created
+ */
+RS_API void rsSetBudget(rsSolver *s, uint64_t ns, uint64_t ops)
+{
+    if (s == NULL)
+        return;
+    s->budgetNs  = ns;
+    s->budgetOps = ops;
+}
+
+/** Load the swap-cost model of solver s from file path; NULL: every swap costs 1
+ * Returns RS_OK or RS_EINVAL
+ * 261018 Created
+ */
+RS_API int32_t rsLoadCosts(rsSolver *s, const char *path)
+{
+    costModel *cm = NULL;
+
+    if ( (s == NULL) || ((path != NULL) && (cm = costLoad(path)) == NULL) )
+        return RS_EINVAL;
+    costUse(NULL);                      // Do not keep the tables of the old model
+    costFree(s->cost);
+    s->cost = cm;
+    return RS_OK;
+}
+
+/** Map the decomposition table of file path for all solvers; NULL: none
+ * Returns RS_OK or RS_EINVAL
+ * 261018 Created
+ */
+RS_API int32_t rsLoadTable(const char *path)
+{
+    if (path == NULL)
+    {
+        tabFree();
+        return RS_OK;
+    }
+    return tabLoad(path) ? RS_OK : RS_EINVAL;
+}
+
+/** Set up the buffers of this thread for the problem of solver s, unless they are set up for it
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char rsBind(const rsSolver *s)
+{
+    if ( (x0 != NULL) && (k == s->k) && (m == s->m) )
+        return 1;
+    return setProblem(s->k, s->m);
+}
+
+/** Copy the labels v into the label vector dst
+ * Returns 0 if v is not a permutation of [1, n]
+ * 261018 Created
+ */
+static char rsLoad(void *dst, const uint32_t *v)
+{
+    unsigned i;
+
+    if (rsSeenCap < n)
+    {
+        free(rsSeen);
+        rsSeenCap = 0;
+        if ((rsSeen = (char*)malloc(n)) == NULL)
+            return 0;
+        rsSeenCap = n;
+    }
+    memset(rsSeen, 0, n);
+    for (i = 0; i < n; i++)
+    {
+        if ( (v[i] == 0) || (v[i] > n) || rsSeen[v[i] - 1] )
+            return 0;
+        rsSeen[v[i] - 1] = 1;
+        SET_LAB(dst, i, v[i]);
+    }
+    return 1;
+}
+
+/** Load the labels x0 and target y of instance in
+ * Returns 0 if they are no permutations of [1, n]
+ * 261018 Created from rsSolve()
+ */
+static char rsLoadInst(const rsInstance *in)
+{
+    unsigned i;
+
+    if (!rsLoad(x0, in->x0))
+        return 0;
+    if (in->y != NULL)
+        return rsLoad(y, in->y);
+    for (i = 0; i < n; i++)
+        SET_LAB(y, i, i + 1);
+    return 1;
+}
+
+/** Clear result out, which has the fields of this version: out->size >= sizeof(rsResult)
+ * 261018 Created
+ */
+static void rsClear(rsResult *out)
+{
+    const uint32_t size = out->size;
+
+    memset(out, 0, sizeof(rsResult));   // Not the fields of a later version
+    out->size = size;
+}
+
+/** Solve instance in with the algorithms alg into out
+ * Returns out->status
+ * 261018 Created
+ * 261018 Compact the schedule of the router (RS_COMPACT)
+ * 261018 Check the sizes of in, out; keep out->size
+ */
+RS_API int32_t rsSolve(rsSolver *s, uint32_t alg, const rsInstance *in, rsResult *out)
+{
+    unsigned long long t;
+    const unsigned r = alg & ALG_ROUTE;
+
+    if ( (out == NULL) || (out->size < sizeof(rsResult)) )
+        return RS_EINVAL;
+    rsClear(out);
+    out->status = RS_EINVAL;
+    if ( (s == NULL) || (in == NULL) || (in->size < sizeof(rsInstance)) || (in->x0 == NULL)
+            || (alg & ~(ALG_ROUTE | ALG_DECOMP | RS_VERIFY | RS_COMPACT))
+            || !(alg & (ALG_ROUTE | ALG_DECOMP)) || (r & (r - 1)) )
+        return out->status;             // Nothing to run, or 2 routers
+    if (!rsBind(s))
+        return (out->status = RS_ENOMEM);
+    if (!rsLoadInst(in))
+        return out->status;
+
+    depth = Ns = Nsb = depthR = 0;
+    wCost = wDepth = 0;
+    costUse(s->cost);
+    solveErr   = ERR_NONE;
+    decompFull = 1;
+    budgetNs   = s->budgetNs;
+    budgetOps  = s->budgetOps;
+    setX();
+    setW();
+    out->alpha = getNmoves();
+    if (r)
+    {
+        t = nsNow();
+        if (in->sched != NULL)
+        {
+            recordSwaps((swapRec*)in->sched, in->schedCap);
+            out->beta = route(r);
+            out->Nsw  = Nrec;
+            recordSwaps(NULL, 0);
+            if ( (alg & RS_COMPACT) && (out->Nsw <= in->schedCap) && !GIVE_UP )
+                compactSched((swapRec*)in->sched, out->Nsw);
+            if ( (alg & RS_VERIFY) && (out->Nsw <= in->schedCap) && !GIVE_UP )
+                verifyRecorded((swapRec*)in->sched, out->Nsw);
+        }
+        else if (alg & (RS_VERIFY | RS_COMPACT))
+            out->beta = routeRecorded(r, ((alg & RS_COMPACT) ? POST_COMPACT : 0) | ((alg & RS_VERIFY) ? POST_VERIFY : 0));
+        else
+            out->beta = route(r);
+        out->tRoute = nsNow() - t;
+        out->depth  = depth;
+        out->depthR = depthR;
+        out->Ns     = Ns;
+        out->Nsb    = Nsb;
+        out->wCost  = wCost;
+        out->wDepth = wDepth;
+    }
+    if (alg & ALG_DECOMP)
+    {
+        setX();
+        setW();
+        t = nsNow();
+        out->beta    = getDecomp();
+        out->tDecomp = nsNow() - t;
+    }
+    out->err     = solveErr;
+    out->partial = !decompFull;
+    if (solveErr)
+        out->status = RS_ESOLVE;
+    else if ( (in->sched != NULL) && (out->Nsw > in->schedCap) )
+        out->status = RS_ESCHED;
+    else
+        out->status = RS_OK;
+    return out->status;
+}
+
+/** Decompose the N instances in[0], .., in[N-1] of solver s into out[0], .., out[N-1] (RS_AT()), LANES
+ * at a time in lockstep (lanes.c); the lanes that are not done go on by decompRest()
+ * Returns the #instances solved with status RS_OK
+ * 261018 Created
+ * 261018 Step through in, out by their size
+ */
+static uint32_t rsSolveLanes(const rsSolver *s, const rsInstance *in, rsResult *out, const uint32_t N)
+{
+    unsigned i0, l, L, Nok = 0;
+    unsigned alpha[LANES], beta[LANES];
+    char ok[LANES], done[LANES];
+    unsigned long long t, tL;
+    const rsInstance *ii[LANES];
+    rsResult *o;
+
+    budgetNs  = s->budgetNs;
+    budgetOps = s->budgetOps;
+    for (i0 = 0; i0 < N; i0 += LANES)
+    {
+        L = (N - i0 < LANES) ? N - i0 : LANES;
+        tL = nsNow();
+        if (!laneStart())
+        {
+            for (l = 0; l < L; l++)
+                ((rsResult*)RS_AT(out, i0 + l))->status = RS_ENOMEM;
+            continue;
+        }
+        for (l = 0; l < L; l++)
+        {
+            ii[l] = (const rsInstance*)RS_AT(in, i0 + l);
+            rsClear((rsResult*)RS_AT(out, i0 + l));
+            if ((ok[l] = (ii[l]->x0 != NULL) && rsLoadInst(ii[l])) != 0)
+                laneAdd(l);
+        }
+        laneDecomp(alpha, beta, done);
+        tL = (nsNow() - tL) / L;        // The share of each lane
+        for (l = 0; l < L; l++)
+        {
+            o = (rsResult*)RS_AT(out, i0 + l);
+            if (!ok[l])
+            {
+                o->status = RS_EINVAL;
+                continue;
+            }
+            o->alpha   = alpha[l];
+            o->beta    = beta[l];
+            o->tDecomp = tL;
+            if (!done[l])               // Go on from the residual of the lane
+            {
+                t = nsNow();
+                rsLoadInst(ii[l]);
+                setX();
+                laneGet(l);
+                solveErr = ERR_NONE;
+                OP_PHASE(PH_DECOMP);
+                TR_BEGIN(TN_DECOMP, 0);
+                o->beta     = decompRest(beta[l]);
+                TR_END(TN_DECOMP);
+                OP_PHASE(PH_ROUTE);
+                o->err      = solveErr;
+                o->partial  = !decompFull;
+                o->tDecomp += nsNow() - t;
+            }
+            o->status = o->err ? RS_ESOLVE : RS_OK;
+            if (o->status == RS_OK)
+                Nok++;
+        }
+    }
+    return Nok;
+}
+
+/** Solve the N instances in[0], .., in[N-1] with the algorithms alg into out[0], .., out[N-1] (RS_AT())
+ * Returns the #instances solved with status RS_OK; 0 if the sizes of the elements are invalid or differ
+ * 261018 Created
+ * 261018 Decompose instances of k <= LANE_MAX_K in lockstep (rsSolveLanes())
+ * 261018 Step through in, out by their size
+ */
+RS_API uint32_t rsSolveBatch(rsSolver *s, uint32_t alg, const rsInstance *in, rsResult *out, uint32_t N)
+{
+    uint32_t i, Nok = 0;
+
+    if ( (in == NULL) || (out == NULL) || (in->size < sizeof(rsInstance)) || (out->size < sizeof(rsResult)) )
+        return 0;
+    for (i = 1; i < N; i++)             // The arrays are strided by the size of their first element
+        if ( (((const rsInstance*)RS_AT(in, i))->size != in->size) || (((rsResult*)RS_AT(out, i))->size != out->size) )
+            return 0;
+    if ( (alg == RS_ALG_DECOMP) && (s != NULL) && (s->k <= LANE_MAX_K) && (N > 1) && rsBind(s) )
+        return rsSolveLanes(s, in, out, N);
+    for (i = 0; i < N; i++)
+        if (rsSolve(s, alg, (const rsInstance*)RS_AT(in, i), (rsResult*)RS_AT(out, i)) == RS_OK)
+            Nok++;
+    return Nok;
+}
+
+/** Write the random instance of seed to xs (n labels in [1, n])
+ * Returns RS_OK or RS_E*
+ * 261018 Created
+ */
+RS_API int32_t rsRandom(rsSolver *s, uint64_t seed, uint32_t *xs)
+{
+    unsigned i;
+
+    if ( (s == NULL) || (xs == NULL) )
+        return RS_EINVAL;
+    if (!rsBind(s))
+        return RS_ENOMEM;
+    srnd(seed);
+    setRandom(x0);
+    for (i = 0; i < n; i++)
+        xs[i] = LAB(x0, i);
+    return RS_OK;
+}
+
+/** Write the instance of seed in family with parameters p1, p2 to xs and ys
+ * Returns RS_OK or RS_E*
+ * 261018 Created
+ */
+RS_API int32_t rsGenerate(rsSolver *s, uint32_t family, uint32_t p1, uint32_t p2, uint64_t seed, uint32_t *xs, uint32_t *ys)
+{
+    genSpec g;
+
+    g.fam   = (char)(family & ~RS_GEN_Y);
+    g.p1    = p1;
+    g.p2    = p2;
+    g.randY = (family & RS_GEN_Y) != 0;
+    if ( (s == NULL) || (xs == NULL) || (ys == NULL) || (g.fam <= GEN_NONE) || (g.fam >= NGEN)
+            || (family & ~(RS_GEN_Y | 0xFF)) )
+        return RS_EINVAL;
+    if (!rsBind(s))
+        return RS_ENOMEM;
+    return genInstance(&g, seed, xs, ys) ? RS_OK : RS_ENOMEM;
+}
+
+/** Get the name of anomaly code err
+ * 261018 Created
+ */
+RS_API const char *rsErrName(int32_t err)
+{
+    return ( (err >= 0) && (err < NERR) ) ? errName[err] : "unknown";
+}
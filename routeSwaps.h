@@ -0,0 +1,162 @@
+/** routeSwaps as a library: a C API to route swaps in fully connected star graphs
+ *
+ * A solver is created for a problem of k centres with m leafs each (n = k(m+1) nodes), and solves
+ * instances of it: initial labels x0 and target labels y, each a permutation of [1, n], where label
+ * x0[i] is on node i. Node g(m+1) is the centre of star g; the others are its leafs.
+ * rsSolve() runs 1 router and/or the cycle decomposition on 1 instance; rsSolveBatch() on an array of
+ * instances in 1 call. The results are written to rsResult records and the schedule of the router to
+ * the rsSwap buffer of the instance, both given by the caller; the library keeps no pointer to them.
+ *
+ * The solver buffers are those of the calling thread, and are kept between the calls. A solver is
+ * used by 1 thread at a time; solvers used by different threads run concurrently.
+ *
+ * ABI: the structs only use fixed-width types and do not change within RS_API_VERSION; rsSolver is
+ * opaque (version 2 added the weighted cost and depth to rsResult, 3 rsLoadTable(), 4 RS_COMPACT,
+ * 5 rsThreadCleanup(), 6 the size of rsInstance and rsResult).
+ * The caller sets the size field of each rsInstance and rsResult to sizeof of its struct. A size of a
+ * later version (larger) is accepted: the library reads and writes only the fields it knows, and
+ * rsSolveBatch() steps through the arrays by size, so fields added later do not shift or get
+ * overwritten. Build the library with RS_BUILD_DLL to export the API from a DLL, and define RS_DLL to
+ * import it from one. The library exports only the API (see routeSwaps/lib.c).
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#ifndef ROUTESWAPS_H
+#define ROUTESWAPS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RS_API_VERSION  6
+
+#if defined(_WIN32) && defined(RS_BUILD_DLL)
+#define RS_API          __declspec(dllexport)
+#elif defined(_WIN32) && defined(RS_DLL)
+#define RS_API          __declspec(dllimport)
+#elif defined(__GNUC__)
+#define RS_API          __attribute__((visibility("default")))
+#else
+#define RS_API
+#endif
+
+// Algorithms to run (alg); at most 1 router
+#define RS_ALG_SIMPLE   1               // Router routeSimple: star pair by star pair
+#define RS_ALG_DECOMP   2               // Cycle decomposition getDecomp: beta
+#define RS_ALG_STAGES   4               // Router routeStages: a matching of swaps per stage
+#define RS_ALG_CYCLES   8               // Router routeCycles: along the cycle decomposition
+#define RS_VERIFY       16              // Replay the schedule of the router and verify it
+#define RS_COMPACT      32              // Compact the stages of the schedule of the router (before RS_VERIFY)
+
+// Families of rsGenerate() (see gen.c); or'ed with RS_GEN_Y for a random target y
+#define RS_GEN_UNIFORM  1               // Uniform random permutation
+#define RS_GEN_CYCLES   2               // p2 cycles through p1 random stars each (0: k stars, m+1 cycles)
+#define RS_GEN_NEAR     3               // Sorted, except p1% of the labels (0: 5%)
+#define RS_GEN_LOCAL    4               // Shuffled within blocks of p1 stars (0: 1 star)
+#define RS_GEN_DELWORST 5               // p1 5-cycles over 5 layers of stars (0: all nodes): worst case of delCycles
+#define RS_GEN_Y        0x100           // Uniform random target y
+
+// Status of a solve
+#define RS_OK           0
+#define RS_EINVAL       (-1)            // Invalid argument: alg, size, or x0/y not a permutation of [1, n]
+#define RS_ENOMEM       (-2)            // Out of memory
+#define RS_ESCHED       (-3)            // The schedule did not fit in sched; Nsw gives its #swaps
+#define RS_ESOLVE       (-4)            // The solver gave up after an anomaly; see err
+
+typedef struct rsSolver rsSolver;
+
+typedef struct
+{
+    uint32_t i, j;                      // Swapped nodes in [0, n-1]; j is a centre if it is an expensive swap
+    uint32_t d;                         // Stage
+} rsSwap;
+
+typedef struct
+{
+    uint32_t size;                      // sizeof(rsInstance) of the caller; set before each call
+    const uint32_t *x0;                 // Initial labels in [1, n]
+    const uint32_t *y;                  // Target labels in [1, n]; NULL: y = (1, ..., n)
+    rsSwap   *sched;                    // Buffer for the schedule of the router; NULL: not recorded
+    uint32_t schedCap;                  // #swaps that fit in sched
+} rsInstance;
+
+typedef struct
+{
+    uint32_t size;                      // sizeof(rsResult) of the caller; set before each call, kept by it
+    int32_t  status;                    // RS_OK or RS_E*
+    int32_t  err;                       // Anomaly code of the solver, 0 if none; see rsErrName()
+    uint32_t depth, Ns, Nsb;            // #stages, #swaps, #expensive swaps of the router; 0 if no router ran
+    uint32_t beta;                      // #expensive swaps of the cycle decomposition; 0 if it did not run
+    uint32_t alpha;                     // #labels not in the star of their target
+    uint32_t partial;                   // 1 if the decomposition ran out of its budget and finished greedily
+    uint32_t Nsw;                       // #swaps of the schedule, also if it did not fit in sched
+    uint32_t depthR;                    // #stages of the router before RS_COMPACT; 0 if not compacted
+    uint64_t tRoute, tDecomp;           // Time of the router, of the decomposition [ns]
+    uint64_t wCost, wDepth;             // Weighted #swaps, weighted depth of the router under the cost model
+} rsResult;
+
+/** Get the API version of the library: RS_API_VERSION */
+RS_API uint32_t rsVersion(void);
+
+/** Create a solver for k centres with m leafs each, and set up its buffers on the calling thread.
+ * Returns NULL if the problem is too large or out of memory */
+RS_API rsSolver *rsCreate(uint32_t k, uint32_t m);
+
+/** Destroy solver s. The solver buffers of the calling thread are kept: other solvers on it may use them */
+RS_API void rsDestroy(rsSolver *s);
+
+/** Release the solver buffers of the calling thread, e.g. before it exits. A solver can still be used on
+ * the thread afterwards; its next call sets the buffers up again */
+RS_API void rsThreadCleanup(void);
+
+/** Get the #nodes n of the problem of solver s */
+RS_API uint32_t rsNodes(const rsSolver *s);
+
+/** Set the budget of the cycle decomposition of solver s: ns nanoseconds and ops operations (0: no limit).
+ * An operation is 1 round of its analysis loop, or 1 star that a pass of its cycle search starts from;
+ * the budget is tested before each. When it runs out, the decomposition finishes greedily and the result
+ * is partial */
+RS_API void rsSetBudget(rsSolver *s, uint64_t ns, uint64_t ops);
+
+/** Load the swap-cost model of solver s from file path (see cost.c); NULL: every swap costs 1.
+ * The routers minimise the weighted cost and depth under it. Returns RS_OK or RS_EINVAL */
+RS_API int32_t rsLoadCosts(rsSolver *s, const char *path);
+
+/** Map the decomposition table of file path (see table.c) for the decompositions of all solvers to
+ * look up their small residuals in; NULL: none. Call it while no solver runs. Returns RS_OK or RS_EINVAL */
+RS_API int32_t rsLoadTable(const char *path);
+
+/** Solve instance in with the algorithms alg (RS_ALG_*, RS_VERIFY, RS_COMPACT) into out.
+ * RS_COMPACT moves each swap of the schedule of the router to the first stage its nodes are free
+ * in, and gives depth and wDepth of the compacted schedule. Returns out->status; RS_EINVAL without
+ * writing out if out->size is too small */
+RS_API int32_t rsSolve(rsSolver *s, uint32_t alg, const rsInstance *in, rsResult *out);
+
+/** Solve the N instances in[0], .., in[N-1] with the algorithms alg into out[0], .., out[N-1]; the
+ * elements are in->size and out->size bytes apart.
+ * With alg = RS_ALG_DECOMP and k <= 16 the instances are decomposed 8 at a time in lockstep, with the
+ * results of rsSolve(); tDecomp then includes a share of the lockstep part.
+ * Returns the #instances solved with status RS_OK; 0, without writing out, if a size is too small or the sizes
+ * of the elements differ */
+RS_API uint32_t rsSolveBatch(rsSolver *s, uint32_t alg, const rsInstance *in, rsResult *out, uint32_t N);
+
+/** Write the random instance of seed to x0 (n labels), as the batch runs of routeSwaps generate it.
+ * Returns RS_OK or RS_E* */
+RS_API int32_t rsRandom(rsSolver *s, uint64_t seed, uint32_t *x0);
+
+/** Write the instance of seed in family (RS_GEN_*) with parameters p1, p2 (0: default) to x0 and y
+ * (n labels each). Returns RS_OK or RS_E* */
+RS_API int32_t rsGenerate(rsSolver *s, uint32_t family, uint32_t p1, uint32_t p2, uint64_t seed, uint32_t *x0, uint32_t *y);
+
+/** Get the name of anomaly code err */
+RS_API const char *rsErrName(int32_t err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ROUTESWAPS_H
@@ -0,0 +1,38 @@
+/** The solver as a library with the API of routeSwaps.h: the solver in 1 translation unit,
+ * without the program, the solver service and the batch runs of main.c.
+ * Build it as a static library, or as a DLL with RS_BUILD_DLL defined (CodeBlocks targets Library and DLL).
+ * Both only export the RS_API functions, not the solver state and functions (k, m, W, setW(), ...): the
+ * DLL exports only the functions declared dllexport, and the Library target makes all other global
+ * symbols of the static library local afterwards (objcopy --keep-global-symbol).
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define RS_BUILD_LIB                    // Leave out the parts of the program; keep the API (routeSwaps.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include <time.h>
+#include "../handleVariables.c"
+#include "../arena.c"
+#include "../opCount.c"
+#include "../trace.c"
+#include "../par.c"
+#include "../getDecomposition.c"
+#include "../table.c"
+#include "../lanes.c"
+#include "../listCycles.c"
+#include "../cost.c"
+#include "../schedule.c"
+#include "../routeSimple.c"
+#include "../routeStages.c"
+#include "../routeCycles.c"
+#include "../route.c"
+#include "../gen.c"
+#include "../verify.c"
+#include "../routeSwaps.c"
+
+TLS unsigned Nd;                        // #digits of the node labels
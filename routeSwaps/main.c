@@ -13,18 +13,40 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <winsock2.h>           // For the solver service; include before windows.h
 #include <windows.h>            // For SYSTEMTIME
 #include <time.h>
 #include <sys/time.h>
 #include "../handleVariables.c"
+#include "../arena.c"
+#include "../opCount.c"
+#include "../trace.c"
+#include "../par.c"
 #include "../getDecomposition.c"
+#include "../table.c"
+#include "../lanes.c"
+#include "../listCycles.c"
+#include "../cost.c"
+#include "../schedule.c"
 #include "../routeSimple.c"
+#include "../routeStages.c"
+#include "../routeCycles.c"
+#include "../route.c"
+#include "../gen.c"
+#include "../verify.c"
+#include "../routeSwaps.c"
+#include "../server.c"
+#include "../stats.c"
+#include "../batch.c"
+#include "../sweep.c"
 
-extern unsigned *x0, *y;        // Input vector, output vector
-extern unsigned depth, Ns, Nsb;
-extern unsigned dbg;            // dbg = 1 to debug the program, otherwise 0
+extern TLS void *x0, *y;        // Input vector, output vector
+extern TLS unsigned depth, Ns, Nsb;
+extern TLS unsigned dbg;        // dbg = 1 to debug the program, otherwise 0
 
-unsigned        Nd;
+TLS unsigned    Nd;
+char            fcsQuiet;       // 1: load(), save() only report errors (testFcs.c)
 unsigned        start, finish;
 SYSTEMTIME      st;
 FILETIME        ft;
@@ -38,16 +60,44 @@ static void solveByMyAlg(const char *fname);
 void load(const char *fname);
 void save(char *fname);
 
-int main()
+/** Usage: routeSwaps                      Interactive
+ *         routeSwaps [options]             Batch run; see usage()
+ *         routeSwaps -sweep JOURNAL [options]  Resumable sweep; see sweep.c
+ *         routeSwaps -merge OUT|- JOURNAL...   Merge the journals of sweeps
+ *         routeSwaps -serve [path|-] [T] [COSTS|-] [TABLE]   Solver service on Unix domain socket path or stdin,
+ *                                          using T threads, under swap-cost model COSTS, with decomposition table TABLE
+ *         routeSwaps -table PATH K M       Make the decomposition table of k <= K, W(i,j) <= M; see table.c
+ */
+int main(int argc, char **argv)
 {
     static unsigned DtT, NstT, NsbtT;   // For trivial alg.: Total #stages, total #swaps, total #expensive swaps
     static unsigned DtM, NstM, NsbtM;   // For my alg.:      Total #stages, total #swaps, total #expensive swaps
     static unsigned msecT, msecM;
+    static runStats rs;                 // Statistics per instance
     unsigned i, a, b, b2, cnt0;
+    unsigned long long t;
+    instRec r;
     unsigned nonOpt;                    // #non-optimal solutions
     char in;
     char fname[LINE_LEN] = "p";
 
+    if ( (argc > 1) && !strcmp(argv[1], "-serve") )
+    {
+        if ( (argc > 4) && strcmp(argv[4], "-") && (costDefault = costLoad(argv[4])) == NULL )
+            return EXIT_FAILURE;
+        if ( (argc > 5) && !tabLoad(argv[5]) )
+            return EXIT_FAILURE;
+        return serve(argc > 2 ? argv[2] : NULL, argc > 3 ? atoi(argv[3]) : 0);
+    }
+    if ( (argc > 1) && !strcmp(argv[1], "-sweep") )
+        return runSweep(argc, argv);
+    if ( (argc > 1) && !strcmp(argv[1], "-merge") )
+        return runMerge(argc, argv);
+    if ( (argc == 5) && !strcmp(argv[1], "-table") )
+        return tabMake(argv[2], strtoul(argv[3], NULL, 10), strtoul(argv[4], NULL, 10));
+    if (argc > 1)
+        return runBatch(argc, argv);
+
     init();
     dbg   = 0;
     DtT   = 0;
@@ -63,7 +113,7 @@ int main()
     cnt0  = 0;  // Count #times alg. 1 is better than 2
     nonOpt = 0;
     for (i = 0; i < n; i++)
-        y[i] = i + 1;
+        SET_LAB(y, i, i + 1);
 
 #ifdef LOAD_P
     sprintf(fname, "p");
@@ -84,12 +134,17 @@ int main()
         printC();
     }
     printNcLen();
+    freeMem();
     return 0;
 #endif // LOAD_P
 
     for (i = 0; i < REPEAT; i++)
     {
         setRandom(x0);
+        solveErr = ERR_NONE;
+#ifdef OP_COUNT
+        opReset();
+#endif
 #ifdef PRINT_STATE
         puts("> BEGIN state:");
         printState();
@@ -100,9 +155,20 @@ int main()
 #endif // PRINT_STATE
 
         // Run trivial algorithm & set statistics
+        memset(&r, 0, sizeof(r));
+        r.seed = i;
+        r.k    = k;
+        r.m    = m;
         tic();
+        t = nsNow();
         routeSimple();                   // RUN trivial algorithm routeSimple
+        r.tRoute = nsNow() - t;
         msecT += toc();
+        r.depth = depth;
+        r.Ns    = Ns;
+        r.Nsb   = Nsb;
+        r.wCost  = wCost;
+        r.wDepth = wDepth;
         DtT   += depth;
         NstT  += Ns;
         NsbtT += Nsb;
@@ -111,13 +177,20 @@ int main()
         printState();
 #endif // PRINT_STATE
         // Run my algorithm & set statistics
-        setX();
-        setW();
         tic();
-        b2 = getDecomp();
+        t = nsNow();
+        b2 = routeCycles();
+        r.tDecomp = nsNow() - t;
         msecM += toc();
+        r.beta  = b2;
+        r.alpha = getNmoves();
+        r.err   = solveErr;
+#ifdef OP_COUNT
+        opStore(r.ops);
+#endif
+        statsAdd(&rs, &r);
         b     += b2;
-        a     += getNmoves();
+        a     += r.alpha;
         DtM   += depth;
         NstM  += Ns;
         NsbtM += Nsb;
@@ -128,11 +201,9 @@ int main()
 #endif // PRINT_STATE
     }
     printf("\n%u/%u\n", cnt0, REPEAT);
-    NstM  = a;
-    NsbtM = b;
 
     // Print statistics
-    printf("\nAVG %u\tSimple\tMy\tBetter\tWon\tOpt\tMy-Opt\n", REPEAT);
+    printf("\nAVG %u\tRoute\tMy\tBetter\tWon\tOpt\tMy-Opt\n", REPEAT);
     printf("d    \t%.1f\t%.1f\t%c\t%.1f\n", (float)DtT/REPEAT, (float)DtM/REPEAT, DtM < DtT ? 'Y' : ' ', ((float)DtT - (float)DtM)/REPEAT);
     printf("#s(a)\t%.1f\t%.1f\t%c\t%.1f\t%.1f\n", (float)(NstT-NsbtT)/REPEAT, (float)(NstM-NsbtM)/REPEAT, (NstM-NsbtM) < (NstT-NsbtT) ? 'Y' : ' ', ((float)(NstT-NsbtT)-(float)(NstM-NsbtM))/REPEAT, (float)a/REPEAT);
     COLOR_TEXT;
@@ -142,6 +213,8 @@ int main()
     printf("M    \t \t \t \t \t%.1f\n", (float)NstM/REPEAT);
     printf("time \t%.2f\t%.2f\n", (float)msecT/REPEAT, (float)msecM/REPEAT);
     printf("Non-opt\t%2u\n", nonOpt);
+    puts("");
+    printStats(&rs);
 
     while ((in = getchar()) != 'c')
     {
@@ -170,6 +243,7 @@ int main()
             loadP(fname);   // Load fully connected star graph problem
         }
     }
+    freeMem();
 
     return 0;
 }
@@ -205,7 +279,9 @@ unsigned toc()
 static void loadP(const char *fname)
 {
     load(fname);        // Load fully connected star graph problem
+    solveErr = ERR_NONE;
     setX();
+    setW();
 }
 
 /** Solve the problem with my solving algorithm
@@ -223,12 +299,15 @@ static void solveByMyAlg(const char *fname)
     printf("#s\t%u\ntime\t%u ms\n", Ns, t);
 }
 
-/** Load problem from path
+/** Load problem from path; the target y is read if the problem has it
  * 170523 Created
+ * 261018 Keep the labels in [1, n]; read y
+ * 261018 Read all n labels of y
+ * 261018 Quiet if fcsQuiet
  */
 void load(const char *fname)
 {
-    unsigned i;
+    unsigned i, xi;
     char line[LINE_LEN];
     char path[LINE_LEN];
 
@@ -244,18 +323,30 @@ void load(const char *fname)
     sscanf(&line[2], "%u %u", &k, &m);  // Read parameters k, m
     n = k * (m+1);                      // Compute #nodes
     while ( fgets(line, LINE_LEN, fp) && (line[0] != 'x') );    // Find initial assignment x0
-    for (i = 0; fgets(line, LINE_LEN, fp); i++)
+    for (i = 0; fgets(line, LINE_LEN, fp) && (line[0] != 'y') && (i < n); i++)
     {
-        sscanf(line, "%u", &x0[i]);     // Read state numbers in [n]
-        x0[i]--;                        // Convert numbers to [n]-1
+        sscanf(line, "%u", &xi);        // Read state numbers in [n]
+        SET_LAB(x0, i, xi);
+    }
+    if (line[0] == 'y')                 // The problem has a target y
+    {
+        for (i = 0; (i < n) && fgets(line, LINE_LEN, fp); i++)
+        {
+            sscanf(line, "%u", &xi);    // Read target y
+            SET_LAB(y, i, xi);
+        }
     }
 
     fclose(fp);
-    printf("> Problem loaded from \"%s\"\n", path);
+    if (!fcsQuiet)
+        printf("> Problem loaded from \"%s\"\n", path);
 }
 
-/** Save problem as '[fname].fcs'
+/** Save problem as '[fname].fcs'; the target y is saved if it is not (1, ..., n)
  * 170523 Created
+ * 261018 Save the labels in [1, n] as load() reads them
+ * 261018 Save y
+ * 261018 Quiet if fcsQuiet
  */
 void save(char *fname)
 {
@@ -270,8 +361,16 @@ void save(char *fname)
     }
     fprintf(fp, "c Generated by sortFuConStar\nc Used %u centres with %u leafs each: %u nodes\np %u %u\nx\n", k, m, n, k, m);
     for (i = 0; i < n; i++)
-        fprintf(fp, "%*u 0\n", Nd, x0[i] + 1);  // Save initial input vector x0
+        fprintf(fp, "%*u 0\n", Nd, LAB(x0, i));        // Save initial input vector x0
+    for (i = 0; (i < n) && (LAB(y, i) == i + 1); i++);
+    if (i < n)
+    {
+        fputs("y\n", fp);
+        for (i = 0; i < n; i++)
+            fprintf(fp, "%*u 0\n", Nd, LAB(y, i));     // Save target y
+    }
 
     fclose(fp);
-    printf("> Problem saved as \"%s\"\n", path);
+    if (!fcsQuiet)
+        printf("> Problem saved as \"%s\"\n", path);
 }
@@ -0,0 +1,78 @@
+/** Test of the .fcs files: instances with a random target y are written by save() and by
+ * genWriteFcs() (-f fcs), loaded again by load(), and must come back unchanged.
+ * Build it like main.c (CodeBlocks target Test); it returns 0 if all instances pass.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define main routeSwapsMain             // The program of main.c is not used
+#include "main.c"
+#undef main
+
+#define TEST_PATH   "testFcs"           // .fcs file of the test, in the working directory
+
+/** Load TEST_PATH.fcs and compare it with (xs, ys) of the (kk, mm) problem
+ * Returns 1 if equal
+ * 261018 Created
+ */
+static char testLoad(const unsigned kk, const unsigned mm, const unsigned *xs, const unsigned *ys)
+{
+    unsigned i;
+
+    memset(x0, 0, n * labW);
+    memset(y, 0, n * labW);
+    load(TEST_PATH);
+    if ( (k != kk) || (m != mm) )
+        return 0;
+    for (i = 0; i < n; i++)
+        if ( (LAB(x0, i) != xs[i]) || (LAB(y, i) != ys[i]) )
+            return 0;
+    return 1;
+}
+
+int main()
+{
+    static const unsigned K[] = {1, 3, 7, 12}, M[] = {1, 2, 5};
+    unsigned a, b, i, *xs, *ys;
+    unsigned long long seed;
+    unsigned Nbad = 0, N = 0;
+    genSpec g;
+
+    pauseOnErr = 0;
+    fcsQuiet   = 1;                     // Print only the failures and the summary
+    parseGen("uniform+y", &g);
+    for (a = 0; a < sizeof(K) / sizeof(K[0]); a++)
+        for (b = 0; b < sizeof(M) / sizeof(M[0]); b++)
+            for (seed = 1; seed <= 4; seed++)
+            {
+                if (!setProblem(K[a], M[b]))
+                    return EXIT_FAILURE;
+                xs = (unsigned*)malloc(n * sizeof(unsigned));
+                ys = (unsigned*)malloc(n * sizeof(unsigned));
+                if ( !xs || !ys || !genInstance(&g, seed, xs, ys) )
+                    return EXIT_FAILURE;
+                for (i = 0; i < n; i++)
+                {
+                    SET_LAB(x0, i, xs[i]);
+                    SET_LAB(y, i, ys[i]);
+                }
+                save(TEST_PATH);
+                if (!testLoad(K[a], M[b], xs, ys))
+                {
+                    printf("! save(), load(): k = %u, m = %u, seed %llu differs\n", K[a], M[b], seed);
+                    Nbad++;
+                }
+                if ( !genWriteFcs(TEST_PATH ".fcs", xs, ys) || !testLoad(K[a], M[b], xs, ys) )
+                {
+                    printf("! genWriteFcs(), load(): k = %u, m = %u, seed %llu differs\n", K[a], M[b], seed);
+                    Nbad++;
+                }
+                N += 2;
+                free(xs);
+                free(ys);
+            }
+    remove(TEST_PATH ".fcs");
+    printf("> %u of %u round trips failed\n", Nbad, N);
+    return Nbad ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+/** Test of the thread pool of getDecomp() (-p): beta of each instance with k >= PAR_MIN_K, solved
+ * on pools of 2 and 4 threads, must equal beta solved without a pool, also under an operation budget.
+ * Build it like main.c (CodeBlocks target TestPar); it returns 0 if all instances pass.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define main routeSwapsMain             // The program of main.c is not used
+#include "main.c"
+#undef main
+
+#define TEST_SEEDS  8                   // #seeds per family and problem size
+
+/** Decompose the instances of family fam of seeds 1 .. TEST_SEEDS of solver s into beta[]
+ * Returns 0 if a solve failed
+ * 261018 Created
+ */
+static char testBeta(rsSolver *s, const uint32_t fam, uint32_t *xs, uint32_t *ys, uint32_t *beta)
+{
+    rsInstance in;
+    rsResult res;
+    unsigned seed;
+
+    memset(&in, 0, sizeof(in));
+    in.size = sizeof(in);
+    in.x0   = xs;
+    in.y    = ys;
+    res.size = sizeof(res);
+    for (seed = 1; seed <= TEST_SEEDS; seed++)
+    {
+        if ( (rsGenerate(s, fam, 0, 0, seed, xs, ys) != RS_OK) || (rsSolve(s, RS_ALG_DECOMP, &in, &res) != RS_OK) )
+            return 0;
+        beta[seed - 1] = res.beta;
+    }
+    return 1;
+}
+
+int main()
+{
+    static const uint32_t F[] = {RS_GEN_UNIFORM, RS_GEN_CYCLES, RS_GEN_LOCAL | RS_GEN_Y, RS_GEN_DELWORST};
+    static const unsigned K[] = {PAR_MIN_K, 64}, M[] = {2, 3}, T[] = {2, 4}, B[] = {0, 300, 1000};
+    uint32_t beta0[TEST_SEEDS], beta[TEST_SEEDS], *xs, *ys;
+    unsigned a, b, f, t, i, o;
+    unsigned Nbad = 0, N = 0;
+    rsSolver *s;
+
+    pauseOnErr = 0;
+    for (a = 0; a < sizeof(K) / sizeof(K[0]); a++)
+        for (b = 0; b < sizeof(M) / sizeof(M[0]); b++)
+        {
+            if ((s = rsCreate(K[a], M[b])) == NULL)
+                return EXIT_FAILURE;
+            xs = (uint32_t*)malloc(rsNodes(s) * sizeof(uint32_t));
+            ys = (uint32_t*)malloc(rsNodes(s) * sizeof(uint32_t));
+            if (!xs || !ys)
+                return EXIT_FAILURE;
+            for (o = 0; o < sizeof(B) / sizeof(B[0]); o++)
+                for (f = 0; f < sizeof(F) / sizeof(F[0]); f++)
+                {
+                    rsSetBudget(s, 0, B[o]);
+                    if (!testBeta(s, F[f], xs, ys, beta0))
+                        return EXIT_FAILURE;
+                    for (t = 0; t < sizeof(T) / sizeof(T[0]); t++)
+                    {
+                        parStart(T[t]);
+                        if (!testBeta(s, F[f], xs, ys, beta))
+                            return EXIT_FAILURE;
+                        parStop();
+                        for (i = 0; i < TEST_SEEDS; i++, N++)
+                            if (beta[i] != beta0[i])
+                            {
+                                printf("! k = %u, m = %u, family %u, seed %u, budget %u ops: beta %u on %u threads, %u on 1\n",
+                                       K[a], M[b], F[f], i + 1, B[o], beta[i], T[t], beta0[i]);
+                                Nbad++;
+                            }
+                    }
+                }
+            free(xs);
+            free(ys);
+            rsDestroy(s);
+        }
+    printf("> %u of %u instances differ\n", Nbad, N);
+    return Nbad ? EXIT_FAILURE : EXIT_SUCCESS;
+}
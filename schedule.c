@@ -0,0 +1,133 @@
+/** Record of the swaps done by a router, to return, verify or post-process its schedule
+ *
+ * compactSched() re-levels a recorded schedule into the fewest stages its swaps allow: 2 swaps
+ * depend on each other iff they share a node, and a swap goes in the stage after the last earlier
+ * swap of either of its nodes (ASAP). Swaps on disjoint nodes commute, so the schedule still sorts
+ * the same labels; a node, and so a centre, is in at most 1 swap per stage. The routers open stages
+ * conservatively (routeSimple() opens one before each centre swap and fixes the centres at stage
+ * boundaries), so this can fold many of their half-empty stages together.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+typedef struct
+{
+    unsigned i, j;                      // Swapped nodes; j is a centre if it is an expensive swap
+    unsigned d;                         // Stage
+} swapRec;
+
+TLS swapRec  *sched;                    // Recorded swaps, NULL if the swaps are not recorded
+TLS unsigned Nrec;                      // #swaps done since recordSwaps(); can exceed recCap
+TLS unsigned recCap;                    // #swaps that fit in sched
+TLS unsigned depthR;                    // Depth of the last schedule compacted, before compactSched()
+static TLS unsigned *cReady;            // cReady[i] = stage of the last swap of node i (compactSched())
+static TLS unsigned *cCnt;              // #swaps per stage, then its first position; cMax after it
+static TLS unsigned *cMax;              // cMax[d] = cost of the most expensive swap of stage d
+static TLS swapRec  *cTmp;              // Compacted schedule, before it is sorted by stage
+static TLS size_t   cReadyCap, cCntCap, cTmpCap;
+
+/** Grow the buffer *buf of elements of size sz to hold >= need elements
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char growBuf(void **buf, size_t *cap, const size_t need, const size_t sz)
+{
+    void *p;
+    size_t c = *cap ? *cap : 64;
+
+    if (need <= *cap)
+        return 1;
+    while (c < need)
+        c *= 2;
+    if ((p = realloc(*buf, c * sz)) == NULL)
+        return 0;
+    *buf = p;
+    *cap = c;
+    return 1;
+}
+
+/** Record the swaps done from now on in buf, which can store cap swaps.
+ * Stop recording if buf is NULL.
+ * 261018 Created
+ */
+void recordSwaps(swapRec *buf, const unsigned cap)
+{
+    sched  = buf;
+    recCap = buf ? cap : 0;
+    Nrec   = 0;
+}
+
+/** Record swap (i,j) in the current stage, and count it
+ * 261018 Created
+ * 261018 Add its cost; record a centre-centre swap in its cheaper direction
+ * 261018 Trace it
+ */
+static void recSwap(unsigned i, unsigned j)
+{
+    OP_INC(((i % (m+1)) || (j % (m+1))) ? OC_SWAP_CHEAP : OC_SWAP_EXP);
+    costSwap(&i, &j);
+    TR_SWAP(i, j);
+    if (sched == NULL)
+        return;
+    if (Nrec < recCap)
+    {
+        sched[Nrec].i = i;
+        sched[Nrec].j = j;
+        sched[Nrec].d = depth;
+    }
+    Nrec++;                             // Count the swap, also if it does not fit
+}
+
+/** Compact the stages of the schedule s of Nsw swaps of the last route(): move each swap to the
+ * first stage after the swaps before it on its nodes, and keep the swaps sorted by stage. Set depth
+ * and wDepth to those of the compacted schedule, and depthR to the depth before; Ns, Nsb and wCost
+ * do not change. Under a cost model the stages can mix swaps of other costs: if that would raise
+ * wDepth, s is kept.
+ * Returns the depth
+ * 261018 Created
+ */
+unsigned compactSched(swapRec *s, const unsigned Nsw)
+{
+    unsigned p, d, dep = 0, c;
+    unsigned long long wDep = 0;
+
+    depthR = depth;
+    if ( !growBuf((void**)&cReady, &cReadyCap, n, sizeof(unsigned))
+            || !growBuf((void**)&cCnt, &cCntCap, 2 * (Nsw + 1), sizeof(unsigned))
+            || !growBuf((void**)&cTmp, &cTmpCap, Nsw, sizeof(swapRec)) )
+    {
+        anomaly(ERR_NO_MEM, "! Compact: out of memory\n");
+        return depth;
+    }
+    cMax = &cCnt[Nsw + 1];
+    memset(cReady, 0, n * sizeof(unsigned));
+    memset(cCnt, 0, 2 * (Nsw + 1) * sizeof(unsigned));
+    for (p = 0; p < Nsw; p++)           // ASAP: the earliest stage after both nodes are free
+    {
+        d = 1 + (cReady[s[p].i] > cReady[s[p].j] ? cReady[s[p].i] : cReady[s[p].j]);
+        cReady[s[p].i] = cReady[s[p].j] = d;
+        cTmp[p]   = s[p];
+        cTmp[p].d = d;
+        cCnt[d]++;
+        if ((c = costOf(s[p].i, s[p].j)) > cMax[d])
+            cMax[d] = c;
+        if (d > dep)
+            dep = d;
+    }
+    for (d = 1; d <= dep; d++)          // Weighted depth: the most expensive swap per stage
+        wDep += cMax[d];
+    if (wDep > wDepth)
+        return depth;
+    for (d = 1, c = 0; d <= dep; d++)   // Counting sort by stage, stable: first position per stage
+    {
+        p       = cCnt[d];
+        cCnt[d] = c;
+        c      += p;
+    }
+    for (p = 0; p < Nsw; p++)
+        s[cCnt[cTmp[p].d]++] = cTmp[p];
+    depth  = dep;
+    wDepth = wDep;
+    return depth;
+}
@@ -0,0 +1,666 @@
+/** Solver service: a pool of worker threads, each keeping its solver buffers warm,
+ * solves the requests read from a Unix domain socket or from stdin.
+ * The responses are written to the connection the request came from.
+ *
+ * Each request is one line:
+ *   solve <id> <alg> <k> <m> <opt> <x0: n labels> [<y: n labels>]
+ *   alg: simple (routeSimple), stages (routeStages), cycles (routeCycles), decomp (getDecomp), or a router
+ *        and decomp joined by '+', e.g. stages+decomp; both = simple+decomp
+ *   opt: '-', or a combination of 'y' (y is given, otherwise y = (1, ..., n)) and 's' (return the schedule),
+ *        optionally followed by 'b' and the budget of getDecomp() (see parseBudget()), e.g. ysb500us
+ *   Labels are in [1, n].
+ * Each response is one line:
+ *   ok <id> <depth> <Ns> <Nsb> <beta> [partial] [cost <wCost> <wDepth>] [sched <#swaps> <i j d>...]
+ *   partial: getDecomp() ran out of its budget, so beta is that of a greedy finish
+ *   cost: weighted #swaps and depth of the router, if the service runs under a swap-cost model (cost.c)
+ *   err <id> <reason>; reason is the anomaly name (errName) if the solver gave up
+ *   depth, Ns, Nsb are 0 if no router ran; beta is 0 if getDecomp() did not run.
+ *   Swapped nodes i, j are in [1, n]; d is the stage of the swap.
+ * Requests are solved concurrently, so the responses can come in any order.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#include <afunix.h>
+
+#define ID_LEN          32              // Max length of a request id
+#define TOK_LEN         32              // Max length of a token
+#define BUF_LEN         4096            // Size of the read buffer of a connection
+#define SERVE_MAX_N     (1u << 24)      // Max #nodes of a request
+
+typedef struct
+{
+    SOCKET   s;                         // Socket, INVALID_SOCKET if stdin/stdout is used
+    char     buf[BUF_LEN];              // Read buffer
+    unsigned len, pos;                  // #bytes in buf, read position
+    int      back;                      // Character pushed back, EOF if none
+    char     eof;                       // End of input reached
+    CRITICAL_SECTION wLock;             // Lock to write a response
+    volatile LONG refs;                 // 1 for the reader + #pending jobs
+} conn;
+
+typedef struct job
+{
+    struct job *next;
+    conn     *c;                        // Connection to respond to
+    char     id[ID_LEN];
+    char     alg;                       // ALG_*
+    char     wantSched;                 // Return the schedule
+    unsigned long long budgetNs, budgetOps;     // Budget of getDecomp(); 0: no budget
+    unsigned k, m;
+    unsigned *x0, *y;                   // Labels in [1, n]; y is NULL if y = (1, ..., n)
+} job;
+
+static job      *qHead, *qTail;         // Queue of jobs to solve
+static char     qClosed;                // No jobs will be added anymore
+static CRITICAL_SECTION   qLock;
+static CONDITION_VARIABLE qCond;
+
+static TLS swapRec  *wSched;            // Schedule buffer of a worker
+static TLS unsigned wSchedCap;
+static TLS char     *wOut;              // Response buffer of a worker
+static TLS size_t   wOutCap;
+
+/** Parse the algorithms to run: simple, stages, cycles, decomp, or a router and decomp joined by '+';
+ * both = simple+decomp
+ * Returns ALG_* flags, 0 if invalid
+ * 261018 Created
+ */
+char parseAlg(const char *s)
+{
+    char alg = 0, a;
+    size_t len;
+
+    if (!strcmp(s, "both"))
+        return ALG_SIMPLE | ALG_DECOMP;
+    while (*s)
+    {
+        len = strcspn(s, "+");
+        if ( (len == 6) && !strncmp(s, "simple", len) )
+            a = ALG_SIMPLE;
+        else if ( (len == 6) && !strncmp(s, "stages", len) )
+            a = ALG_STAGES;
+        else if ( (len == 6) && !strncmp(s, "cycles", len) )
+            a = ALG_CYCLES;
+        else if ( (len == 6) && !strncmp(s, "decomp", len) )
+            a = ALG_DECOMP;
+        else
+            return 0;
+        if ( (alg & a) || ((a & ALG_ROUTE) && (alg & ALG_ROUTE)) )
+            return 0;                   // Twice, or 2 routers
+        alg |= a;
+        s += len;
+        if (*s == '+')
+            s++;
+    }
+    return alg;
+}
+
+/** Parse the budget of getDecomp(): <N>us, <N>ms, <N>s or <N>ops; a plain number is in us
+ * Returns 0 if invalid
+ * 261018 Created
+ * 261018 Reject times that overflow in ns
+ */
+char parseBudget(const char *s, unsigned long long *ns, unsigned long long *ops)
+{
+    unsigned long long v, unit = 0;     // unit: #ns per unit of v; 0: v is #operations
+    char *end;
+
+    *ns  = 0;
+    *ops = 0;
+    if ( (*s < '0') || (*s > '9') )
+        return 0;
+    v = strtoull(s, &end, 10);
+    if ( !*end || !strcmp(end, "us") )
+        unit = 1000;
+    else if (!strcmp(end, "ms"))
+        unit = 1000000;
+    else if (!strcmp(end, "s"))
+        unit = 1000000000;
+    else if (strcmp(end, "ops"))
+        return 0;
+    if (!unit)
+        *ops = v;
+    else if (v > ULLONG_MAX / unit)
+        return 0;                       // Overflows
+    else
+        *ns = v * unit;
+    return 1;
+}
+
+/** Create a connection for socket s (INVALID_SOCKET: stdin/stdout)
+ * 261018 Created
+ */
+static conn *newConn(const SOCKET s)
+{
+    conn *c = (conn*)calloc(1, sizeof(conn));
+
+    if (c == NULL)
+        return NULL;
+    c->s    = s;
+    c->back = EOF;
+    c->refs = 1;
+    InitializeCriticalSection(&c->wLock);
+    return c;
+}
+
+/** Release a reference to connection c; close it if it was the last one
+ * 261018 Created
+ */
+static void connRelease(conn *c)
+{
+    if (InterlockedDecrement(&c->refs))
+        return;
+    if (c->s != INVALID_SOCKET)
+        closesocket(c->s);
+    DeleteCriticalSection(&c->wLock);
+    free(c);
+}
+
+/** Get the next character of connection c, EOF at the end of the input
+ * 261018 Created
+ */
+static int connGetc(conn *c)
+{
+    int r;
+
+    if (c->back != EOF)
+    {
+        r = c->back;
+        c->back = EOF;
+        return r;
+    }
+    if (c->s == INVALID_SOCKET)
+        return getchar();
+    if (c->pos == c->len)
+    {
+        r = recv(c->s, c->buf, BUF_LEN, 0);
+        if (r <= 0)
+            return EOF;
+        c->len = r;
+        c->pos = 0;
+    }
+    return (unsigned char)c->buf[c->pos++];
+}
+
+/** Write len bytes of buf to connection c as one response
+ * 261018 Created
+ */
+static void connWrite(conn *c, const char *buf, size_t len)
+{
+    int r;
+
+    EnterCriticalSection(&c->wLock);
+    if (c->s == INVALID_SOCKET)
+    {
+        fwrite(buf, 1, len, stdout);
+        fflush(stdout);
+    }
+    else
+    {
+        while (len && ((r = send(c->s, buf, (int)len, 0)) > 0))
+        {
+            buf += r;
+            len -= r;
+        }
+    }
+    LeaveCriticalSection(&c->wLock);
+}
+
+/** Respond to request id with an error
+ * 261018 Created
+ */
+static void replyErr(conn *c, const char *id, const char *reason)
+{
+    char line[ID_LEN + 64];
+
+    connWrite(c, line, sprintf(line, "err %s %s\n", id, reason));
+}
+
+/** Read the next token of the current line into tok.
+ * Returns 0 at the end of the line or the input.
+ * 261018 Created
+ */
+static char getTok(conn *c, char *tok)
+{
+    int ch;
+    unsigned i = 0;
+
+    while ( ((ch = connGetc(c)) == ' ') || (ch == '\t') || (ch == '\r') );
+    if ( (ch == '\n') || (ch == EOF) )
+    {
+        c->back = ch;
+        return 0;
+    }
+    for (; (ch != EOF) && (ch != ' ') && (ch != '\t') && (ch != '\r') && (ch != '\n'); ch = connGetc(c))
+        if (i < TOK_LEN - 1)
+            tok[i++] = (char)ch;
+    tok[i] = 0;
+    c->back = ch;
+    return 1;
+}
+
+/** Skip the rest of the current line
+ * Returns 0 at the end of the input
+ * 261018 Created
+ */
+static char skipLine(conn *c)
+{
+    int ch;
+
+    while ( ((ch = connGetc(c)) != '\n') && (ch != EOF) );
+    if (ch == EOF)
+        c->eof = 1;
+    return (ch != EOF);
+}
+
+/** Read nn labels in [1, nn] forming a permutation into v; seen is scratch of nn bytes
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char getLabels(conn *c, unsigned *v, const unsigned nn, char *seen)
+{
+    unsigned i;
+    char tok[TOK_LEN];
+
+    memset(seen, 0, nn);
+    for (i = 0; i < nn; i++)
+    {
+        if (!getTok(c, tok) || (sscanf(tok, "%u", &v[i]) != 1) || (v[i] == 0) || (v[i] > nn) || seen[v[i]-1])
+            return 0;
+        seen[v[i]-1] = 1;
+    }
+    return 1;
+}
+
+/** Free a job
+ * 261018 Created
+ */
+static void freeJob(job *jb)
+{
+    free(jb->x0);
+    free(jb->y);
+    free(jb);
+}
+
+/** Add a job to the queue
+ * 261018 Created
+ */
+static void pushJob(job *jb)
+{
+    jb->next = NULL;
+    EnterCriticalSection(&qLock);
+    if (qTail)
+        qTail->next = jb;
+    else
+        qHead = jb;
+    qTail = jb;
+    WakeConditionVariable(&qCond);
+    LeaveCriticalSection(&qLock);
+}
+
+/** Take the next job from the queue; wait for it if the queue is empty.
+ * Returns NULL if the queue is closed and empty
+ * 261018 Created
+ */
+static job *popJob()
+{
+    job *jb;
+
+    EnterCriticalSection(&qLock);
+    while (!qHead && !qClosed)
+        SleepConditionVariableCS(&qCond, &qLock, INFINITE);
+    jb = qHead;
+    if (jb)
+    {
+        qHead = jb->next;
+        if (qHead == NULL)
+            qTail = NULL;
+    }
+    LeaveCriticalSection(&qLock);
+    return jb;
+}
+
+/** Parse one request line of connection c into a job
+ * Returns NULL if the request is invalid (it has been answered) or if there is no request
+ * 261018 Created
+ */
+static job *readJob(conn *c)
+{
+    char tok[TOK_LEN], opt[TOK_LEN];
+    char *seen = NULL, *bud;
+    const char *reason = "bad request";
+    unsigned nn;
+    job *jb;
+
+    if (!getTok(c, tok))
+    {
+        skipLine(c);
+        return NULL;                    // Empty line
+    }
+    jb = (job*)calloc(1, sizeof(job));
+    if (jb == NULL)
+    {
+        skipLine(c);
+        replyErr(c, "?", "out of memory");
+        return NULL;
+    }
+    strcpy(jb->id, "?");
+    if (strcmp(tok, "solve") || !getTok(c, jb->id))
+        goto fail;
+    if (!getTok(c, tok))
+        goto fail;
+    if ((jb->alg = parseAlg(tok)) == 0)
+    {
+        reason = "unknown alg";
+        goto fail;
+    }
+    if (!getTok(c, tok) || (sscanf(tok, "%u", &jb->k) != 1) || !getTok(c, tok) || (sscanf(tok, "%u", &jb->m) != 1)
+            || !getTok(c, opt))
+        goto fail;
+    if ( (jb->k == 0) || (jb->m == 0) || ((unsigned long long)jb->k * (jb->m + 1) > SERVE_MAX_N) )
+    {
+        reason = "bad size";
+        goto fail;
+    }
+    nn = jb->k * (jb->m + 1);
+    if ( (bud = strchr(opt, 'b')) != NULL )
+    {
+        if (!parseBudget(bud + 1, &jb->budgetNs, &jb->budgetOps))
+        {
+            reason = "bad budget";
+            goto fail;
+        }
+        *bud = 0;                       // Keep the flags only
+    }
+    jb->wantSched = (strchr(opt, 's') != NULL);
+    jb->x0 = (unsigned*)malloc(nn * sizeof(unsigned));
+    seen   = (char*)malloc(nn);
+    if (strchr(opt, 'y'))
+        jb->y = (unsigned*)malloc(nn * sizeof(unsigned));
+    if ( !jb->x0 || !seen || (strchr(opt, 'y') && !jb->y) )
+    {
+        reason = "out of memory";
+        goto fail;
+    }
+    if ( !getLabels(c, jb->x0, nn, seen) || (jb->y && !getLabels(c, jb->y, nn, seen)) )
+    {
+        reason = "bad labels";
+        goto fail;
+    }
+    if (getTok(c, tok))
+        goto fail;                      // Line too long
+    free(seen);
+    skipLine(c);
+    jb->c = c;
+    return jb;
+
+fail:
+    skipLine(c);
+    replyErr(c, jb->id, reason);
+    free(seen);
+    freeJob(jb);
+    return NULL;
+}
+
+/** Read the requests of connection c until the end of its input, and queue them
+ * 261018 Created
+ */
+static void readJobs(conn *c)
+{
+    job *jb;
+
+    while (!c->eof)
+    {
+        if ((jb = readJob(c)) == NULL)
+            continue;
+        InterlockedIncrement(&c->refs);
+        pushJob(jb);
+    }
+}
+
+/** Ensure that the response buffer of this worker has >= len bytes
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char outGrow(const size_t len)
+{
+    char *p;
+
+    if (len <= wOutCap)
+        return 1;
+    p = (char*)realloc(wOut, len);
+    if (p == NULL)
+        return 0;
+    wOut    = p;
+    wOutCap = len;
+    return 1;
+}
+
+/** Ensure that the schedule buffer of this worker can store >= cap swaps
+ * Returns 0 if failed
+ * 261018 Created
+ */
+static char growSched(const unsigned cap)
+{
+    swapRec *p;
+
+    if (cap <= wSchedCap)
+        return 1;
+    p = (swapRec*)realloc(wSched, cap * sizeof(swapRec));
+    if (p == NULL)
+        return 0;
+    wSched    = p;
+    wSchedCap = cap;
+    return 1;
+}
+
+/** Solve a job in this worker thread and respond to it
+ * 261018 Created
+ */
+static void solveJob(job *jb)
+{
+    unsigned i, beta = 0, Nsw = 0;
+    size_t len;
+
+    if (!setProblem(jb->k, jb->m))
+    {
+        replyErr(jb->c, jb->id, "cannot set up problem");
+        return;
+    }
+    for (i = 0; i < n; i++)
+    {
+        SET_LAB(x0, i, jb->x0[i]);
+        SET_LAB(y, i, jb->y ? jb->y[i] : i + 1);
+    }
+    depth = Ns = Nsb = 0;
+    wCost = wDepth = 0;
+    solveErr   = ERR_NONE;
+    decompFull = 1;
+    budgetNs   = jb->budgetNs;
+    budgetOps  = jb->budgetOps;
+    if (jb->alg & ALG_ROUTE)
+    {
+        if (jb->wantSched && !growSched(2 * n))
+        {
+            replyErr(jb->c, jb->id, "out of memory");
+            return;
+        }
+        recordSwaps(jb->wantSched ? wSched : NULL, wSchedCap);
+        beta = route(jb->alg);
+        if (jb->wantSched && (Nrec > wSchedCap))    // Schedule did not fit: grow the buffer and route again
+        {
+            if (!growSched(Nrec))
+            {
+                recordSwaps(NULL, 0);
+                replyErr(jb->c, jb->id, "out of memory");
+                return;
+            }
+            recordSwaps(wSched, wSchedCap);
+            beta = route(jb->alg);
+        }
+        Nsw = Nrec;
+        recordSwaps(NULL, 0);
+    }
+    if (jb->alg & ALG_DECOMP)
+    {
+        setX();
+        setW();
+        beta = getDecomp();
+    }
+
+    // Respond
+    if (solveErr)
+    {
+        replyErr(jb->c, jb->id, errName[(int)solveErr]);
+        return;
+    }
+    if (!outGrow(ID_LEN + 144 + ((jb->wantSched && (jb->alg & ALG_ROUTE)) ? (size_t)Nsw * 33 : 0)))
+    {
+        replyErr(jb->c, jb->id, "out of memory");
+        return;
+    }
+    len = sprintf(wOut, "ok %s %u %u %u %u%s", jb->id, depth, Ns, Nsb, beta, decompFull ? "" : " partial");
+    if (costDefault != NULL)
+        len += sprintf(&wOut[len], " cost %llu %llu", wCost, wDepth);
+    if (jb->wantSched && (jb->alg & ALG_ROUTE))
+    {
+        len += sprintf(&wOut[len], " sched %u", Nsw);
+        for (i = 0; i < Nsw; i++)
+            len += sprintf(&wOut[len], " %u %u %u", wSched[i].i + 1, wSched[i].j + 1, wSched[i].d);
+    }
+    wOut[len++] = '\n';
+    connWrite(jb->c, wOut, len);
+}
+
+/** Worker thread: solve jobs until the queue is closed
+ * 261018 Created
+ */
+static DWORD WINAPI worker(LPVOID arg)
+{
+    job *jb;
+
+    (void)arg;
+    while ((jb = popJob()) != NULL)
+    {
+        solveJob(jb);
+        connRelease(jb->c);
+        freeJob(jb);
+    }
+    freeMem();
+    free(wSched);
+    free(wOut);
+    return 0;
+}
+
+/** Reader thread of a socket connection
+ * 261018 Created
+ */
+static DWORD WINAPI reader(LPVOID arg)
+{
+    readJobs((conn*)arg);
+    connRelease((conn*)arg);
+    return 0;
+}
+
+/** Accept connections on the Unix domain socket path and read their requests
+ * Returns only if failed
+ * 261018 Created
+ */
+static int listenOn(const char *path)
+{
+    WSADATA wsa;
+    SOCKET ls, s;
+    struct sockaddr_un sa;
+    conn *c;
+    HANDLE th;
+
+    if (WSAStartup(MAKEWORD(2, 2), &wsa))
+    {
+        puts("! Unable to start Winsock");
+        return EXIT_FAILURE;
+    }
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+    DeleteFileA(path);                  // Remove the socket file of a previous run
+    ls = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( (ls == INVALID_SOCKET) || bind(ls, (struct sockaddr*)&sa, sizeof(sa)) || listen(ls, SOMAXCONN) )
+    {
+        printf("! Unable to listen on \"%s\"\n", path);
+        WSACleanup();
+        return EXIT_FAILURE;
+    }
+    printf("> Listening on \"%s\"\n", path);
+    fflush(stdout);
+    while ((s = accept(ls, NULL, NULL)) != INVALID_SOCKET)
+    {
+        if ((c = newConn(s)) == NULL)
+        {
+            closesocket(s);
+            continue;
+        }
+        th = CreateThread(NULL, 0, reader, c, 0, NULL);
+        if (th == NULL)
+            connRelease(c);
+        else
+            CloseHandle(th);
+    }
+    closesocket(ls);
+    WSACleanup();
+    return EXIT_FAILURE;
+}
+
+/** Run the solver service with Nthreads worker threads (0: 1/processor)
+ * on the Unix domain socket path, or on stdin/stdout if path is NULL or "-".
+ * Returns the exit code
+ * 261018 Created
+ */
+int serve(const char *path, unsigned Nthreads)
+{
+    unsigned i;
+    int ret = 0;
+    HANDLE *th;
+    conn *c;
+
+    if (Nthreads == 0)
+        Nthreads = getNcpu();
+    pauseOnErr = 0;                     // Answer anomalies by an error response
+    InitializeCriticalSection(&qLock);
+    InitializeConditionVariable(&qCond);
+    th = (HANDLE*)malloc(Nthreads * sizeof(HANDLE));
+    if (th == NULL)
+        return EXIT_FAILURE;
+    for (i = 0; i < Nthreads; i++)
+        th[i] = CreateThread(NULL, 0, worker, NULL, 0, NULL);
+
+    if ( (path == NULL) || !strcmp(path, "-") )
+    {
+        if ((c = newConn(INVALID_SOCKET)) == NULL)
+            ret = EXIT_FAILURE;
+        else
+        {
+            readJobs(c);
+            connRelease(c);
+        }
+    }
+    else
+        ret = listenOn(path);
+
+    // Let the workers finish the queued jobs
+    EnterCriticalSection(&qLock);
+    qClosed = 1;
+    WakeAllConditionVariable(&qCond);
+    LeaveCriticalSection(&qLock);
+    for (i = 0; i < Nthreads; i++)
+    {
+        if (th[i] == NULL)
+            continue;
+        WaitForSingleObject(th[i], INFINITE);
+        CloseHandle(th[i]);
+    }
+    free(th);
+    DeleteCriticalSection(&qLock);
+    return ret;
+}
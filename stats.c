@@ -0,0 +1,340 @@
+/** Statistics of solved instances: a sink that streams one record per instance as CSV, JSON lines
+ * or binary records, and fixed-memory online quantile histograms per metric.
+ *
+ * A histogram has QH_SUB buckets per power of 2 (log-linear, like HDR histograms), so quantiles
+ * have a relative error < 1/QH_SUB, whatever the range of the values. Histograms of different
+ * threads are merged by adding their buckets.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define QH_SUB_BITS     6                               // log2(#buckets per power of 2)
+#define QH_SUB          (1 << QH_SUB_BITS)              // #buckets per power of 2
+#define QH_N            (QH_SUB + (64 - QH_SUB_BITS) * QH_SUB)  // #buckets to hold any 64-bit value
+
+#define STATS_NONE      0               // Formats of the sink
+#define STATS_CSV       1
+#define STATS_JSONL     2
+#define STATS_BIN       3
+
+#define STATS_MAGIC     0x54535352      // "RSST": header of a binary stats file
+#define STATS_VERSION   5
+
+enum {ST_DEPTH, ST_DEPTH_R, ST_NS, ST_NSB, ST_W_COST, ST_W_DEPTH, ST_ALPHA, ST_BETA, ST_T_ROUTE, ST_T_DECOMP, NSTAT};   // Metrics
+
+static const char *statName[NSTAT] = {"depth", "depthR", "Ns", "Nsb", "wCost", "wDepth", "alpha", "beta", "tRoute", "tDecomp"};
+
+typedef struct
+{
+    unsigned long long seed;            // Seed the instance is generated with
+    unsigned k, m;                      // Problem size
+    unsigned depth, Ns, Nsb;            // Result of the routing
+    unsigned alpha, beta;               // #moves (getNmoves()), beta (getDecomp())
+    unsigned long long tRoute;          // Time of the router [ns]
+    unsigned long long tDecomp;         // Time of getDecomp() [ns]
+    unsigned long long wCost, wDepth;   // Weighted #swaps, weighted depth of the routing (cost.c)
+    unsigned err;                       // Anomaly code, ERR_NONE if solved
+    unsigned partial;                   // 1 if getDecomp() ran out of its budget and finished greedily
+    unsigned depthR;                    // Depth of the router before compactSched(); 0 if not compacted; last, as added later
+#ifdef OP_COUNT
+    unsigned long long ops[NPH][NOC];   // Operation counters per phase
+#endif
+} instRec;
+
+typedef struct
+{
+    unsigned long long cnt, sum, max;   // #values, sum of the values, max value
+    unsigned long long b[QH_N];         // #values per bucket
+} qHist;
+
+typedef struct
+{
+    unsigned long long N;               // #instances
+    unsigned long long Nerr[NERR];      // #instances per anomaly
+    unsigned long long Npartial;        // #instances of which getDecomp() ran out of its budget
+    qHist h[NSTAT];                     // Histogram per metric of the solved instances
+#ifdef OP_COUNT
+    unsigned long long ops[NPH][NOC];   // Sum of the operation counters of all instances
+#endif
+} runStats;
+
+static FILE *statsFp;                   // Sink
+static char statsFmt;                   // STATS_*
+static CRITICAL_SECTION statsLock;      // Lock to write records from several threads
+
+/** Get the bucket of value v
+ * 261018 Created
+ */
+static inline unsigned qhBucket(const unsigned long long v)
+{
+    unsigned e;
+
+    if (v < QH_SUB)
+        return (unsigned)v;
+    e = 63 - __builtin_clzll(v);                        // v in [2^e, 2^(e+1))
+    return QH_SUB + (e - QH_SUB_BITS) * QH_SUB + (unsigned)((v >> (e - QH_SUB_BITS)) & (QH_SUB - 1));
+}
+
+/** Get the largest value in bucket bi
+ * 261018 Created
+ */
+static unsigned long long qhUpper(const unsigned bi)
+{
+    unsigned e;
+
+    if (bi < QH_SUB)
+        return bi;
+    e = (bi - QH_SUB) / QH_SUB + QH_SUB_BITS;
+    return ((unsigned long long)(QH_SUB + (bi & (QH_SUB - 1))) << (e - QH_SUB_BITS)) + (1ULL << (e - QH_SUB_BITS)) - 1;
+}
+
+/** Add value v to histogram h
+ * 261018 Created
+ */
+void qhAdd(qHist *h, const unsigned long long v)
+{
+    h->cnt++;
+    h->sum += v;
+    if (v > h->max)
+        h->max = v;
+    h->b[qhBucket(v)]++;
+}
+
+/** Add histogram src to histogram dst
+ * 261018 Created
+ */
+void qhMerge(qHist *dst, const qHist *src)
+{
+    unsigned bi;
+
+    dst->cnt += src->cnt;
+    dst->sum += src->sum;
+    if (src->max > dst->max)
+        dst->max = src->max;
+    for (bi = 0; bi < QH_N; bi++)
+        dst->b[bi] += src->b[bi];
+}
+
+/** Get the q-quantile (q in [0, 1]) of histogram h: the largest value of the bucket that holds it
+ * 261018 Created
+ */
+unsigned long long qhQuantile(const qHist *h, const double q)
+{
+    unsigned bi;
+    unsigned long long rank, cnt = 0, v;
+
+    if (h->cnt == 0)
+        return 0;
+    rank = (unsigned long long)(q * (h->cnt - 1)) + 1; // 1-based rank of the quantile
+    for (bi = 0; bi < QH_N; bi++)
+    {
+        cnt += h->b[bi];
+        if (cnt >= rank)
+            break;
+    }
+    v = qhUpper(bi);
+    return v < h->max ? v : h->max;
+}
+
+/** Add the record of an instance to the statistics s
+ * 261018 Created
+ */
+void statsAdd(runStats *s, const instRec *r)
+{
+#ifdef OP_COUNT
+    unsigned p, c;
+
+    for (p = 0; p < NPH; p++)
+        for (c = 0; c < NOC; c++)
+            s->ops[p][c] += r->ops[p][c];
+#endif
+    s->N++;
+    s->Nerr[r->err]++;
+    s->Npartial += r->partial;
+    if (r->err != ERR_NONE)
+        return;
+    qhAdd(&s->h[ST_DEPTH], r->depth);
+    qhAdd(&s->h[ST_DEPTH_R], r->depthR);
+    qhAdd(&s->h[ST_NS], r->Ns);
+    qhAdd(&s->h[ST_NSB], r->Nsb);
+    qhAdd(&s->h[ST_W_COST], r->wCost);
+    qhAdd(&s->h[ST_W_DEPTH], r->wDepth);
+    qhAdd(&s->h[ST_ALPHA], r->alpha);
+    qhAdd(&s->h[ST_BETA], r->beta);
+    qhAdd(&s->h[ST_T_ROUTE], r->tRoute);
+    qhAdd(&s->h[ST_T_DECOMP], r->tDecomp);
+}
+
+/** Add the statistics src to dst
+ * 261018 Created
+ */
+void statsMerge(runStats *dst, const runStats *src)
+{
+    unsigned i;
+
+    dst->N += src->N;
+    dst->Npartial += src->Npartial;
+    for (i = 0; i < NERR; i++)
+        dst->Nerr[i] += src->Nerr[i];
+    for (i = 0; i < NSTAT; i++)
+        qhMerge(&dst->h[i], &src->h[i]);
+#ifdef OP_COUNT
+    for (i = 0; i < NOC; i++)
+    {
+        dst->ops[PH_ROUTE][i]  += src->ops[PH_ROUTE][i];
+        dst->ops[PH_DECOMP][i] += src->ops[PH_DECOMP][i];
+    }
+#endif
+}
+
+/** Print the mean, p50, p90, p99 and max per metric of the statistics s. The times are printed in us.
+ * A metric that is 0 for every instance is left out, except alpha and beta: those are always measured.
+ * 261018 Created
+ * 261018 Always print alpha and beta
+ */
+void printStats(const runStats *s)
+{
+    unsigned i;
+    double div;
+    const qHist *h;
+
+    printf("%-8s %10s %10s %10s %10s %10s\n", "", "mean", "p50", "p90", "p99", "max");
+    for (i = 0; i < NSTAT; i++)
+    {
+        h = &s->h[i];
+        if ( (h->max == 0) && (i != ST_ALPHA) && (i != ST_BETA) )
+            continue;                   // Not measured
+        div = (i >= ST_T_ROUTE) ? 1e3 : 1;
+        printf("%-8s %10.1f %10.1f %10.1f %10.1f %10.1f\n", statName[i],
+               h->cnt ? (double)h->sum / h->cnt / div : 0, qhQuantile(h, 0.5) / div, qhQuantile(h, 0.9) / div,
+               qhQuantile(h, 0.99) / div, h->max / div);
+    }
+    for (i = 1; i < NERR; i++)
+        if (s->Nerr[i])
+            printf("! %s\t%llu\n", errName[i], s->Nerr[i]);
+    if (s->Npartial)
+        printf("> partial\t%llu\n", s->Npartial);
+#ifdef OP_COUNT
+    if (s->N == 0)
+        return;
+    printf("%-10s %12s %12s\n", "ops/inst", phName[PH_ROUTE], phName[PH_DECOMP]);
+    for (i = 0; i < NOC; i++)
+        if (s->ops[PH_ROUTE][i] || s->ops[PH_DECOMP][i])
+            printf("%-10s %12.1f %12.1f\n", ocName[i], (double)s->ops[PH_ROUTE][i] / s->N,
+                   (double)s->ops[PH_DECOMP][i] / s->N);
+#endif
+}
+
+#ifdef OP_COUNT
+/** Write the operation counters of record r to the sink: CSV columns or a JSON object
+ * 261018 Created
+ */
+static void writeOps(const instRec *r)
+{
+    unsigned p, c;
+
+    for (p = 0; p < NPH; p++)
+    {
+        if (statsFmt == STATS_JSONL)
+            fprintf(statsFp, "%s\"%s\":{", p ? "," : ",\"ops\":{", phName[p]);
+        for (c = 0; c < NOC; c++)
+            if (statsFmt == STATS_CSV)
+                fprintf(statsFp, ",%llu", r->ops[p][c]);
+            else
+                fprintf(statsFp, "%s\"%s\":%llu", c ? "," : "", ocName[c], r->ops[p][c]);
+        if (statsFmt == STATS_JSONL)
+            fputc('}', statsFp);
+    }
+    if (statsFmt == STATS_JSONL)
+        fputc('}', statsFp);
+}
+#endif // OP_COUNT
+
+/** Open the sink: write the records to path (stdout if NULL or "-") in format fmt
+ * Returns 0 if failed
+ * 261018 Created
+ */
+char statsOpen(const char *path, const char fmt)
+{
+    unsigned hdr[3] = {STATS_MAGIC, STATS_VERSION, sizeof(instRec)};
+#ifdef OP_COUNT
+    unsigned p, c;
+#endif
+
+    statsFmt = fmt;
+    if (fmt == STATS_NONE)
+        return 1;
+    if ( (path == NULL) || !strcmp(path, "-") )
+        statsFp = stdout;
+    else if ((statsFp = fopen(path, fmt == STATS_BIN ? "wb" : "w")) == NULL)
+    {
+        printf("! Unable to use the path \"%s\"\n", path);
+        statsFmt = STATS_NONE;
+        return 0;
+    }
+    InitializeCriticalSection(&statsLock);
+    if (fmt == STATS_CSV)
+    {
+        fputs("seed,k,m,depth,Ns,Nsb,wCost,wDepth,alpha,beta,tRoute,tDecomp,err,partial,depthR", statsFp);
+#ifdef OP_COUNT
+        for (p = 0; p < NPH; p++)
+            for (c = 0; c < NOC; c++)
+                fprintf(statsFp, ",%s_%s", phName[p], ocName[c]);
+#endif
+        fputc('\n', statsFp);
+    }
+    else if (fmt == STATS_BIN)
+        fwrite(hdr, sizeof(hdr), 1, statsFp);
+    return 1;
+}
+
+/** Write the record of an instance to the sink. Thread safe.
+ * 261018 Created
+ */
+void statsWrite(const instRec *r)
+{
+    if (statsFmt == STATS_NONE)
+        return;
+    EnterCriticalSection(&statsLock);
+    switch (statsFmt)
+    {
+    case STATS_CSV:
+        fprintf(statsFp, "%llu,%u,%u,%u,%u,%u,%llu,%llu,%u,%u,%llu,%llu,%s,%u,%u", r->seed, r->k, r->m, r->depth, r->Ns,
+                r->Nsb, r->wCost, r->wDepth, r->alpha, r->beta, r->tRoute, r->tDecomp, errName[r->err], r->partial,
+                r->depthR);
+#ifdef OP_COUNT
+        writeOps(r);
+#endif
+        fputc('\n', statsFp);
+        break;
+    case STATS_JSONL:
+        fprintf(statsFp, "{\"seed\":%llu,\"k\":%u,\"m\":%u,\"depth\":%u,\"Ns\":%u,\"Nsb\":%u,\"wCost\":%llu,\"wDepth\":%llu,"
+                "\"alpha\":%u,\"beta\":%u,\"tRoute\":%llu,\"tDecomp\":%llu,\"err\":\"%s\",\"partial\":%u,\"depthR\":%u",
+                r->seed, r->k, r->m, r->depth, r->Ns, r->Nsb, r->wCost, r->wDepth, r->alpha, r->beta, r->tRoute,
+                r->tDecomp, errName[r->err], r->partial, r->depthR);
+#ifdef OP_COUNT
+        writeOps(r);
+#endif
+        fputs("}\n", statsFp);
+        break;
+    case STATS_BIN:
+        fwrite(r, sizeof(instRec), 1, statsFp);
+    }
+    LeaveCriticalSection(&statsLock);
+}
+
+/** Close the sink
+ * 261018 Created
+ */
+void statsClose()
+{
+    if (statsFmt == STATS_NONE)
+        return;
+    if (statsFp == stdout)
+        fflush(statsFp);
+    else
+        fclose(statsFp);
+    DeleteCriticalSection(&statsLock);
+    statsFmt = STATS_NONE;
+}
@@ -0,0 +1,568 @@
+/** Resumable parameter sweeps over (k, m, seed), split into shards, with a journal of the results
+ *
+ * A sweep solves the random instances of seeds S, .., S+R-1 for each point (k, m) of the lists given.
+ * The seeds of a point are split into shards of Z seeds, numbered over all points in order. Process I
+ * of N (-w I/N) solves the shards j with j % N = I, so independent processes, on 1 or more machines,
+ * share a sweep without talking to each other.
+ * Each solved instance is appended to the journal of the process as a record with a checksum, and
+ * flushed, so it survives a crash of the process; at the end of a shard the journal is committed
+ * to disk. A sweep run again with its journal reads it first and skips the instances in it, so
+ * completed shards are skipped and an interrupted shard continues where it stopped. A record torn
+ * by a crash fails its checksum; it and anything after it are ignored and overwritten.
+ * -merge reads the journals of the processes, drops duplicate instances, writes 1 journal and
+ * prints the statistics per point.
+ *
+ * Journal: header {JRN_MAGIC, JRN_VERSION, sizeof(instRec), alg, checksum of the cost model, budget of
+ * getDecomp() in ns and in operations}, then jrnEntry's. A sweep only resumes, and -merge only merges,
+ * journals of the same algorithms, costs and budget.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#include <io.h>                         // For _commit()
+
+#define JRN_MAGIC       0x4C4A5352      // "RSJL": header of a journal
+#define JRN_VERSION     4
+#define JRN_HDR_LEN     (5 * sizeof(unsigned) + 2 * sizeof(unsigned long long))    // Size of the header
+#define SWEEP_MAX_LIST  32              // Max #values of k, of m
+#define SWEEP_SHARD     100             // Default #seeds per shard
+#define JRN_READ        0               // Modes of jrnOpen(): open a journal to read it,
+#define JRN_RESUME      1               // to read and append to it, or create it
+#define JRN_NEW         2               // create a new one
+
+typedef struct
+{
+    instRec r;
+    unsigned long long sum;             // Checksum of r
+} jrnEntry;
+
+typedef struct
+{
+    unsigned Nk, Nm;                    // #values of k, m
+    unsigned k[SWEEP_MAX_LIST], m[SWEEP_MAX_LIST];
+    unsigned repeat;                    // #seeds per point
+    unsigned long long seed;            // First seed
+    unsigned shard;                     // #seeds per shard
+    unsigned wi, wn;                    // This is process wi of wn
+    unsigned Nthreads;                  // #threads; 0: 1/processor
+    char     alg;                       // ALG_*
+    unsigned long long budgetNs, budgetOps;     // Budget of getDecomp(); 0: no budget
+    char     verify;                    // Replay and verify the schedule of the router
+    const char *jrn;                    // Path of the journal
+} sweepArgs;
+
+static sweepArgs        sArgs;
+static unsigned         swNpts;         // #points (k, m)
+static unsigned         swNshards;      // #shards per point
+static volatile LONG    swNext;         // Next shard to solve
+static unsigned long long *swDone;      // Bit per (point, seed): the instance is in the journal
+static unsigned         swWords;        // #words of swDone per point
+static runStats         **swStats;      // Statistics per point
+static FILE             *swFp;          // Journal
+static CRITICAL_SECTION swLock;         // Lock to append to the journal and add to swStats
+
+/** Get the checksum of record r (FNV-1a over its bytes)
+ * 261018 Created
+ */
+static unsigned long long jrnSum(const instRec *r)
+{
+    const unsigned char *b = (const unsigned char*)r;
+    unsigned long long h = 0xCBF29CE484222325ULL;
+    size_t i;
+
+    for (i = 0; i < sizeof(instRec); i++)
+        h = (h ^ b[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+/** Open journal path in mode JRN_*. The header of an existing journal is checked against the record
+ * size of this build and *alg, *cost, budget[0..1] are set to its algorithms, the checksum of its cost
+ * model and its budget (ns, ops); *alg, *cost, budget are written to a new journal.
+ * Returns NULL if failed
+ * 261018 Created
+ * 261018 Budget of getDecomp() in the header
+ */
+static FILE *jrnOpen(const char *path, const char mode, char *alg, unsigned *cost, unsigned long long *budget)
+{
+    unsigned hdr[5];
+    FILE *fp;
+
+    if ( (mode != JRN_NEW) && (fp = fopen(path, mode == JRN_READ ? "rb" : "r+b")) != NULL )
+    {
+        if ( (fread(hdr, sizeof(hdr), 1, fp) != 1) || (hdr[0] != JRN_MAGIC) || (hdr[1] != JRN_VERSION)
+                || (hdr[2] != sizeof(instRec)) || (fread(budget, 2 * sizeof(unsigned long long), 1, fp) != 1) )
+        {
+            printf("! \"%s\" is not a journal of this build\n", path);
+            fclose(fp);
+            return NULL;
+        }
+        *alg  = (char)hdr[3];
+        *cost = hdr[4];
+        return fp;
+    }
+    if ( (mode == JRN_READ) || (fp = fopen(path, "w+b")) == NULL )
+    {
+        printf("! Unable to use the path \"%s\"\n", path);
+        return NULL;
+    }
+    hdr[0] = JRN_MAGIC;
+    hdr[1] = JRN_VERSION;
+    hdr[2] = sizeof(instRec);
+    hdr[3] = (unsigned char)*alg;
+    hdr[4] = *cost;
+    fwrite(hdr, sizeof(hdr), 1, fp);
+    fwrite(budget, 2 * sizeof(unsigned long long), 1, fp);
+    fflush(fp);
+    return fp;
+}
+
+/** Read the next entry of journal fp into r
+ * Returns 0 at the end of the journal, or at a torn entry
+ * 261018 Created
+ */
+static char jrnNext(FILE *fp, instRec *r)
+{
+    jrnEntry e;
+
+    if ( (fread(&e, sizeof(e), 1, fp) != 1) || (e.sum != jrnSum(&e.r)) || (e.r.err >= NERR) )
+        return 0;
+    *r = e.r;
+    return 1;
+}
+
+/** Append record r to journal fp, and flush it
+ * 261018 Created
+ */
+static void jrnAppend(FILE *fp, const instRec *r)
+{
+    jrnEntry e;
+
+    memset(&e, 0, sizeof(e));
+    e.r   = *r;
+    e.sum = jrnSum(r);
+    fwrite(&e, sizeof(e), 1, fp);
+    fflush(fp);
+}
+
+/** Parse a list of values v[,v..] into vals
+ * Returns the #values, 0 if invalid
+ * 261018 Created
+ */
+static unsigned parseList(const char *s, unsigned *vals)
+{
+    unsigned N = 0;
+    char *end;
+
+    while (N < SWEEP_MAX_LIST)
+    {
+        vals[N] = strtoul(s, &end, 10);
+        if ( (end == s) || (vals[N] == 0) )
+            return 0;
+        N++;
+        if (*end == 0)
+            return N;
+        if (*end != ',')
+            return 0;
+        s = end + 1;
+    }
+    return 0;
+}
+
+/** Parse the arguments of a sweep into sArgs
+ * Returns 0 if they are invalid
+ * 261018 Created
+ */
+static char parseSweepArgs(int argc, char **argv)
+{
+    int i;
+    const char *v;
+    char *end;
+
+    if (argc < 3)
+        return 0;
+    sArgs.jrn      = argv[2];
+    sArgs.Nk       = 1;
+    sArgs.k[0]     = 10;
+    sArgs.Nm       = 1;
+    sArgs.m[0]     = SET_M;
+    sArgs.repeat   = REPEAT;
+    sArgs.seed     = 1;
+    sArgs.shard    = SWEEP_SHARD;
+    sArgs.wi       = 0;
+    sArgs.wn       = 1;
+    sArgs.Nthreads = 0;
+    sArgs.alg      = ALG_SIMPLE | ALG_DECOMP;
+    sArgs.verify   = 0;
+    for (i = 3; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-v"))
+        {
+            sArgs.verify = 1;
+            continue;
+        }
+        if ( (argv[i][0] != '-') || (argv[i][1] == 0) || argv[i][2] || (i + 1 == argc) )
+            return 0;
+        v = argv[++i];
+        switch (argv[i-1][1])
+        {
+        case 'k':
+            if ((sArgs.Nk = parseList(v, sArgs.k)) == 0)
+                return 0;
+            break;
+        case 'm':
+            if ((sArgs.Nm = parseList(v, sArgs.m)) == 0)
+                return 0;
+            break;
+        case 'r':
+            sArgs.repeat = strtoul(v, NULL, 10);
+            break;
+        case 's':
+            sArgs.seed = strtoull(v, NULL, 10);
+            break;
+        case 'z':
+            sArgs.shard = strtoul(v, NULL, 10);
+            break;
+        case 'w':
+            sArgs.wi = strtoul(v, &end, 10);
+            if (*end != '/')
+                return 0;
+            sArgs.wn = strtoul(end + 1, NULL, 10);
+            break;
+        case 't':
+            sArgs.Nthreads = strtoul(v, NULL, 10);
+            break;
+        case 'a':
+            if ((sArgs.alg = parseAlg(v)) == 0)
+                return 0;
+            break;
+        case 'c':
+            costFree(costDefault);
+            if ((costDefault = costLoad(v)) == NULL)
+                return 0;
+            break;
+        case 'b':
+            if (!parseBudget(v, &sArgs.budgetNs, &sArgs.budgetOps))
+                return 0;
+            break;
+        default:
+            return 0;
+        }
+    }
+    return (sArgs.shard > 0) && (sArgs.wi < sArgs.wn) && (sArgs.repeat > 0)
+        && ((unsigned long long)sArgs.Nk * sArgs.Nm * ((sArgs.repeat + sArgs.shard - 1) / sArgs.shard) <= LONG_MAX);
+}
+
+/** Get the point of the sweep of problem size (kk, mm)
+ * Returns swNpts if it is not in the sweep
+ * 261018 Created
+ */
+static unsigned sweepPoint(const unsigned kk, const unsigned mm)
+{
+    unsigned a, b;
+
+    for (a = 0; (a < sArgs.Nk) && (sArgs.k[a] != kk); a++);
+    for (b = 0; (b < sArgs.Nm) && (sArgs.m[b] != mm); b++);
+    return ( (a < sArgs.Nk) && (b < sArgs.Nm) ) ? a * sArgs.Nm + b : swNpts;
+}
+
+/** Read the journal: mark its instances of the sweep as done and add them to the statistics,
+ * and position the journal to append after its last intact entry.
+ * Returns the #instances of the sweep in the journal
+ * 261018 Created
+ */
+static unsigned long long sweepResume()
+{
+    unsigned p;
+    unsigned long long si, Nin = 0, Ne = 0;
+    unsigned long long *w;
+    instRec r;
+
+    fseek(swFp, JRN_HDR_LEN, SEEK_SET);
+    while (jrnNext(swFp, &r))
+    {
+        Ne++;
+        p  = sweepPoint(r.k, r.m);
+        si = r.seed - sArgs.seed;
+        if ( (p == swNpts) || (r.seed < sArgs.seed) || (si >= sArgs.repeat) )
+            continue;                   // Of another sweep
+        w = &swDone[p * swWords + si / 64];
+        if (*w & (1ULL << (si % 64)))
+            continue;                   // Duplicate
+        *w |= 1ULL << (si % 64);
+        statsAdd(swStats[p], &r);
+        Nin++;
+    }
+    fseek(swFp, JRN_HDR_LEN + Ne * sizeof(jrnEntry), SEEK_SET);  // Overwrite a torn entry
+    return Nin;
+}
+
+/** Sweep worker thread: solve the pending instances of the shards of this process until all are done
+ * 261018 Created
+ */
+static DWORD WINAPI sweepWorker(LPVOID arg)
+{
+    unsigned g, p, pCur = UINT_MAX, j, kk, mm, Nnew;
+    unsigned long long si, siEnd;
+    uint32_t *xs = NULL;
+    rsSolver *rs = NULL;
+    instRec r;
+
+    (void)arg;
+    while ((g = InterlockedIncrement(&swNext) - 1) < swNpts * swNshards)
+    {
+        if (g % sArgs.wn != sArgs.wi)
+            continue;                   // Shard of another process
+        p  = g / swNshards;
+        j  = g % swNshards;
+        kk = sArgs.k[p / sArgs.Nm];
+        mm = sArgs.m[p % sArgs.Nm];
+        si    = (unsigned long long)j * sArgs.shard;
+        siEnd = si + sArgs.shard < sArgs.repeat ? si + sArgs.shard : sArgs.repeat;
+        for (Nnew = 0; si < siEnd; si++)
+        {
+            if (swDone[p * swWords + si / 64] & (1ULL << (si % 64)))
+                continue;               // In the journal
+            if (p != pCur)              // Set up the solver for the point
+            {
+                free(xs);
+                rsDestroy(rs);
+                xs = NULL;
+                if ( (rs = rsCreate(kk, mm)) == NULL
+                        || (xs = (uint32_t*)malloc(rsNodes(rs) * sizeof(uint32_t))) == NULL )
+                {
+                    printf("! Cannot set up a problem with k = %u, m = %u\n", kk, mm);
+                    rsDestroy(rs);
+                    rsThreadCleanup();
+                    return 1;
+                }
+                rsSetBudget(rs, sArgs.budgetNs, sArgs.budgetOps);
+                pCur = p;
+            }
+            memset(&r, 0, sizeof(r));
+            r.seed = sArgs.seed + si;
+            r.k    = kk;
+            r.m    = mm;
+            solveRec(rs, xs, NULL, NULL, sArgs.alg | (sArgs.verify ? RS_VERIFY : 0), &r);
+
+            EnterCriticalSection(&swLock);
+            jrnAppend(swFp, &r);
+            statsAdd(swStats[p], &r);
+            LeaveCriticalSection(&swLock);
+            Nnew++;
+        }
+        if (Nnew)
+        {
+            EnterCriticalSection(&swLock);
+            _commit(_fileno(swFp));     // Shard done: commit it to disk
+            LeaveCriticalSection(&swLock);
+        }
+    }
+    free(xs);
+    if (rs != NULL)
+        rsDestroy(rs);
+    rsThreadCleanup();
+    return 0;
+}
+
+/** Print the statistics of the points of the sweep
+ * 261018 Created
+ */
+static void printSweep()
+{
+    unsigned p;
+
+    for (p = 0; p < swNpts; p++)
+        if (swStats[p]->N)
+        {
+            printf("> k = %u, m = %u: %llu instances\n", sArgs.k[p / sArgs.Nm], sArgs.m[p % sArgs.Nm], swStats[p]->N);
+            printStats(swStats[p]);
+        }
+}
+
+/** Run or resume a sweep with the arguments argv: routeSwaps -sweep JOURNAL [options]
+ * Returns the exit code
+ * 261018 Created
+ * 261018 Do not resume a journal of another budget
+ */
+int runSweep(int argc, char **argv)
+{
+    unsigned i, p;
+    unsigned long long Nin, t0, budget[2];
+    char alg;
+    unsigned cost;
+    HANDLE *th;
+    int ret = EXIT_FAILURE;
+
+    if (!parseSweepArgs(argc, argv))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+    alg  = sArgs.alg | (sArgs.verify ? RS_VERIFY : 0);
+    cost = costSum();
+    budget[0] = sArgs.budgetNs;
+    budget[1] = sArgs.budgetOps;
+    if ((swFp = jrnOpen(sArgs.jrn, JRN_RESUME, &alg, &cost, budget)) == NULL)
+        return EXIT_FAILURE;
+    if ( (alg != (char)(sArgs.alg | (sArgs.verify ? RS_VERIFY : 0))) || (cost != costSum())
+            || (budget[0] != sArgs.budgetNs) || (budget[1] != sArgs.budgetOps) )
+    {
+        printf("! \"%s\" is the journal of a sweep with other algorithms, costs or budget\n", sArgs.jrn);
+        fclose(swFp);
+        return EXIT_FAILURE;
+    }
+    swNpts    = sArgs.Nk * sArgs.Nm;
+    swNshards = (sArgs.repeat + sArgs.shard - 1) / sArgs.shard;
+    swWords   = (sArgs.repeat + 63) / 64;
+    swDone    = (unsigned long long*)calloc((size_t)swNpts * swWords, sizeof(unsigned long long));
+    swStats   = (runStats**)calloc(swNpts, sizeof(runStats*));
+    for (p = 0; swStats && (p < swNpts) && ((swStats[p] = (runStats*)calloc(1, sizeof(runStats))) != NULL); p++);
+    if (sArgs.Nthreads == 0)
+        sArgs.Nthreads = getNcpu();
+    th = (HANDLE*)malloc(sArgs.Nthreads * sizeof(HANDLE));
+    if ( (swDone == NULL) || (swStats == NULL) || (p < swNpts) || (th == NULL) )
+    {
+        puts("! Out of memory");
+        goto done;
+    }
+
+    Nin = sweepResume();
+    printf("> Journal \"%s\": %llu instances of the sweep done\n", sArgs.jrn, Nin);
+    pauseOnErr = 0;
+    swNext     = 0;
+    InitializeCriticalSection(&swLock);
+    t0 = nsNow();
+    for (i = 0; i < sArgs.Nthreads; i++)
+        th[i] = CreateThread(NULL, 0, sweepWorker, NULL, 0, NULL);
+    for (i = 0; i < sArgs.Nthreads; i++)
+    {
+        if (th[i] == NULL)
+            continue;
+        WaitForSingleObject(th[i], INFINITE);
+        CloseHandle(th[i]);
+    }
+    DeleteCriticalSection(&swLock);
+    printf("> Process %u/%u done in %.3f s\n", sArgs.wi, sArgs.wn, (nsNow() - t0) / 1e9);
+    printSweep();
+    ret = EXIT_SUCCESS;
+
+done:
+    free(th);
+    for (p = 0; swStats && (p < swNpts); p++)
+        free(swStats[p]);
+    free(swStats);
+    free(swDone);
+    fclose(swFp);
+    return ret;
+}
+
+/** Compare records by (k, m, seed), for qsort()
+ * 261018 Created
+ */
+static int cmpRec(const void *a, const void *b)
+{
+    const instRec *ra = (const instRec*)a, *rb = (const instRec*)b;
+
+    if (ra->k != rb->k)
+        return ra->k < rb->k ? -1 : 1;
+    if (ra->m != rb->m)
+        return ra->m < rb->m ? -1 : 1;
+    return (ra->seed > rb->seed) - (ra->seed < rb->seed);
+}
+
+/** Merge journals: routeSwaps -merge OUT|- JOURNAL...
+ * The instances of all journals are sorted by (k, m, seed) and written once to journal OUT
+ * (not if OUT is "-"), and the statistics per (k, m) are printed.
+ * Returns the exit code
+ * 261018 Created
+ * 261018 Do not merge journals of different budgets
+ */
+int runMerge(int argc, char **argv)
+{
+    int a;
+    size_t N = 0, cap = 0, i, Nuniq = 0;
+    instRec *recs = NULL, *p;
+    runStats *s;
+    char alg = 0, algA, ok = 1;
+    unsigned cost = 0, costJ;
+    unsigned long long budget[2] = {0, 0}, budgetJ[2];
+    FILE *fp;
+
+    if ( (argc < 4) || ((s = (runStats*)calloc(1, sizeof(runStats))) == NULL) )
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+    for (a = 3; (a < argc) && ok; a++)
+    {
+        if ((fp = jrnOpen(argv[a], JRN_READ, &algA, &costJ, budgetJ)) == NULL)
+            break;
+        if ( (a > 3) && ((algA != alg) || (costJ != cost) || (budgetJ[0] != budget[0]) || (budgetJ[1] != budget[1])) )
+        {
+            printf("! \"%s\" is the journal of a sweep with other algorithms, costs or budget\n", argv[a]);
+            fclose(fp);
+            break;
+        }
+        alg  = algA;
+        cost = costJ;
+        budget[0] = budgetJ[0];
+        budget[1] = budgetJ[1];
+        for (;;)
+        {
+            if (N == cap)
+            {
+                cap = cap ? 2 * cap : 4096;
+                if ((p = (instRec*)realloc(recs, cap * sizeof(instRec))) == NULL)
+                {
+                    puts("! Out of memory");
+                    ok = 0;
+                    break;
+                }
+                recs = p;
+            }
+            if (!jrnNext(fp, &recs[N]))
+                break;
+            N++;
+        }
+        fclose(fp);
+    }
+    if ( (a < argc) || !ok )
+    {
+        free(recs);
+        free(s);
+        return EXIT_FAILURE;
+    }
+
+    qsort(recs, N, sizeof(instRec), cmpRec);
+    fp = NULL;
+    if ( strcmp(argv[2], "-") && (fp = jrnOpen(argv[2], JRN_NEW, &alg, &cost, budget)) == NULL )
+    {
+        free(recs);
+        free(s);
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < N; i++)
+    {
+        if ( (i == 0) || (cmpRec(&recs[i], &recs[i-1]) != 0) )    // Not a duplicate
+        {
+            Nuniq++;
+            if (fp)
+                jrnAppend(fp, &recs[i]);
+            statsAdd(s, &recs[i]);
+        }
+        if ( (i + 1 == N) || (recs[i+1].k != recs[i].k) || (recs[i+1].m != recs[i].m) )
+        {
+            printf("> k = %u, m = %u: %llu instances\n", recs[i].k, recs[i].m, s->N);
+            printStats(s);
+            memset(s, 0, sizeof(runStats));
+        }
+    }
+    if (fp)
+        fclose(fp);
+    printf("> Merged %d journals: %llu instances, %llu duplicates\n", argc - 3, (unsigned long long)Nuniq,
+           (unsigned long long)(N - Nuniq));
+    free(recs);
+    free(s);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,496 @@
+/** Tables of optimal cycle decompositions of the small residual move graphs, to look up instead of
+ * searching them
+ *
+ * A residual is W without its diagonal and 2-cycles (del2cycles(), kernelize()) on at most K stars,
+ * so between 2 stars moves only go 1 way. It is stored per star pair (i, j), i < j, as
+ * v = W(i,j) - W(j,i) in [-M, M], and is Eulerian. The table holds every such residual once, in the
+ * canonical form of its class under renumbering the stars (the least key), with the max #cycles of
+ * a decomposition into cycles, and the 1st cycle of one: removing it leaves the residual of the next
+ * entry, so a decomposition is read in #cycles lookups. An optimal decomposition has a cycle through
+ * each edge, so the entries are computed from the smaller ones by trying the cycles through 1 edge.
+ *
+ * The table of (K, M) covers every instance with k <= K and m < M, and any residual of getDecomp()
+ * that is left on <= K stars with W(i,j) <= M; there getDecomp() takes the optimal decomposition of
+ * the table (tabSolve()). Make it once (routeSwaps -table PATH K M), and map it into memory (tabLoad()).
+ * The file: tabHeader, N keys (unsigned long long, ascending), N values (unsigned short:
+ * #cycles | cycle << 8).
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define TAB_MAGIC       0x54445352      // "RSDT"
+#define TAB_VERSION     1
+#define TAB_MAX_K       5               // Max #stars of a table
+#define TAB_MAX_M       7               // Max |v|: a key has 4 bits per pair
+#define TAB_NP          (TAB_MAX_K * (TAB_MAX_K - 1) / 2)   // Max #star pairs
+#define TAB_NPERM       120             // TAB_MAX_K!
+#define TAB_NCYC        74              // #cycles of length >= 3 on TAB_MAX_K stars
+
+typedef struct
+{
+    unsigned magic, version;
+    unsigned K, M;                      // #stars, max |v|
+    unsigned N;                         // #entries
+    unsigned reserved;
+} tabHeader;
+
+static const tabHeader *tabHdr;         // Table in use; NULL: none
+static const unsigned long long *tabKey;
+static const unsigned short *tabVal;
+static HANDLE tabFile, tabMap;
+static unsigned tabK;                   // #stars of the tables below
+static unsigned char tabPair[TAB_MAX_K][TAB_MAX_K]; // Index of star pair (i, j), i != j
+static unsigned tabNperm;
+static unsigned char tabPerm[TAB_NPERM][TAB_MAX_K]; // Renumberings of the stars: i -> tabPerm[p][i]
+static unsigned tabNcyc;
+static unsigned char tabCyc[TAB_NCYC][TAB_MAX_K];   // Cycles, from their least star
+static unsigned char tabLen[TAB_NCYC];
+
+/** Set up the star pairs, renumberings and cycles of K stars
+ * 261018 Created
+ */
+static void tabInit(const unsigned K)
+{
+    unsigned i, j, p, d, f, len, Np;
+    unsigned char used[TAB_MAX_K];
+    const unsigned char *r;
+
+    if (tabK == K)
+        return;
+    tabK = K;
+    for (i = 0, p = 0; i < K; i++)
+        for (j = i + 1; j < K; j++, p++)
+            tabPair[i][j] = tabPair[j][i] = (unsigned char)p;
+
+    // Renumberings, by counting in the factorial number system
+    for (Np = 1, i = 2; i <= K; i++)
+        Np *= i;
+    for (p = 0; p < Np; p++)
+    {
+        memset(used, 0, sizeof(used));
+        for (i = 0, d = p; i < K; i++)
+        {
+            for (f = 1, j = 2; j < K - i; j++)
+                f *= j;                         // (K-1-i)!
+            for (j = 0, len = d / f; used[j] || len--; j++);
+            d %= f;
+            used[j] = 1;
+            tabPerm[p][i] = (unsigned char)j;
+        }
+    }
+    tabNperm = Np;
+
+    // Cycles: the first len stars of a renumbering, from their least star, with the others in order
+    for (tabNcyc = 0, len = 3; len <= K; len++)
+        for (p = 0; p < Np; p++)
+        {
+            r = tabPerm[p];
+            for (i = 1; (i < len) && (r[i] > r[0]); i++);
+            for (j = len + 1; (j < K) && (r[j-1] < r[j]); j++);
+            if ( (i < len) || (j < K) )
+                continue;
+            memcpy(tabCyc[tabNcyc], r, len);
+            tabLen[tabNcyc++] = (unsigned char)len;
+        }
+}
+
+/** Get the key of residual v: 4 bits per pair
+ * 261018 Created
+ */
+static unsigned long long tabKeyOf(const signed char *v)
+{
+    unsigned p;
+    unsigned long long key = 0;
+
+    for (p = 0; p < tabK * (tabK - 1) / 2; p++)
+        key |= (unsigned long long)((v[p] + 8) & 15) << (4 * p);
+    return key;
+}
+
+/** Get the canonical key of residual v: the least key of its renumberings; *perm is set to the
+ * renumbering of it
+ * 261018 Created
+ */
+static unsigned long long tabCanon(const signed char *v, unsigned *perm)
+{
+    unsigned p, i, j;
+    signed char w[TAB_NP];
+    unsigned long long key, best = ULLONG_MAX;
+    const unsigned char *r;
+
+    for (p = 0; p < tabNperm; p++)
+    {
+        r = tabPerm[p];
+        for (i = 0; i < tabK; i++)
+            for (j = i + 1; j < tabK; j++)
+                w[tabPair[r[i]][r[j]]] = (r[i] < r[j]) ? v[tabPair[i][j]] : (signed char)-v[tabPair[i][j]];
+        if ((key = tabKeyOf(w)) < best)
+        {
+            best  = key;
+            *perm = p;
+        }
+    }
+    return best;
+}
+
+/** Find key in the N ascending keys
+ * Returns its index, or TAB_MISS
+ * 261018 Created
+ */
+static unsigned tabFind(const unsigned long long *keys, const unsigned N, const unsigned long long key)
+{
+    unsigned lo = 0, hi = N, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return ( (lo < N) && (keys[lo] == key) ) ? lo : TAB_MISS;
+}
+
+/** Get the sign in a residual of the moves i -> j: +1 if i < j, else -1
+ * 261018 Created
+ */
+static inline signed char tabDir(const unsigned char i, const unsigned char j)
+{
+    return i < j ? 1 : -1;
+}
+
+/** Check whether residual v holds cycle c
+ * 261018 Created
+ */
+static char tabHolds(const signed char *v, const unsigned c)
+{
+    unsigned t;
+    unsigned char a, b;
+
+    for (t = 0; t < tabLen[c]; t++)
+    {
+        a = tabCyc[c][t];
+        b = tabCyc[c][(t + 1) % tabLen[c]];
+        if (v[tabPair[a][b]] * tabDir(a, b) <= 0)
+            return 0;
+    }
+    return 1;
+}
+
+/** Remove (sgn = 1) or add (sgn = -1) cycle c to residual v
+ * 261018 Created
+ */
+static void tabApply(signed char *v, const unsigned c, const signed char sgn)
+{
+    unsigned t;
+    unsigned char a, b;
+
+    for (t = 0; t < tabLen[c]; t++)
+    {
+        a = tabCyc[c][t];
+        b = tabCyc[c][(t + 1) % tabLen[c]];
+        v[tabPair[a][b]] -= sgn * tabDir(a, b);
+    }
+}
+
+/** Unpack key into residual v
+ * 261018 Created
+ */
+static void tabUnpack(const unsigned long long key, signed char *v)
+{
+    unsigned p;
+
+    for (p = 0; p < tabK * (tabK - 1) / 2; p++)
+        v[p] = (signed char)(((key >> (4 * p)) & 15) - 8);
+}
+
+static const unsigned long long *tabSortKeys;
+
+/** Compare entries by the total #moves of their residuals
+ * 261018 Created
+ */
+static int cmpTabWeight(const void *a, const void *b)
+{
+    signed char v[TAB_NP];
+    unsigned p, wa = 0, wb = 0;
+
+    tabUnpack(tabSortKeys[*(const unsigned*)a], v);
+    for (p = 0; p < tabK * (tabK - 1) / 2; p++)
+        wa += (v[p] < 0) ? -v[p] : v[p];
+    tabUnpack(tabSortKeys[*(const unsigned*)b], v);
+    for (p = 0; p < tabK * (tabK - 1) / 2; p++)
+        wb += (v[p] < 0) ? -v[p] : v[p];
+    return (wa > wb) - (wa < wb);
+}
+
+/** Compare keys
+ * 261018 Created
+ */
+static int cmpTabKey(const void *a, const void *b)
+{
+    const unsigned long long x = *(const unsigned long long*)a, y = *(const unsigned long long*)b;
+
+    return (x > y) - (x < y);
+}
+
+/** Make the table of K stars and |v| <= M, and write it to file path
+ * Returns the exit code
+ * 261018 Created
+ */
+int tabMake(const char *path, const unsigned K, const unsigned M)
+{
+    unsigned i, j, p, e, c, N = 0, cap = 0, Nfree, perm, *order = NULL;
+    unsigned long long Nall = 1, a, key, *keys = NULL, *t;
+    unsigned short *val = NULL;
+    signed char v[TAB_NP];
+    int bal;
+    tabHeader h;
+    FILE *fp;
+
+    if ( (K < 2) || (K > TAB_MAX_K) || (M < 1) || (M > TAB_MAX_M) )
+    {
+        printf("! A table needs 2 <= K <= %u, 1 <= M <= %u\n", TAB_MAX_K, TAB_MAX_M);
+        return EXIT_FAILURE;
+    }
+    tabInit(K);
+
+    // Every Eulerian residual: free v of the pairs (i, j), 1 <= i < j; v(0, j) balances star j
+    Nfree = (K - 1) * (K - 2) / 2;
+    for (p = 0; p < Nfree; p++)
+        Nall *= 2 * M + 1;
+    for (a = 0; a < Nall; a++)
+    {
+        for (i = 1, key = a; i < K; i++)
+            for (j = i + 1; j < K; j++)
+            {
+                v[tabPair[i][j]] = (signed char)(key % (2 * M + 1)) - (signed char)M;
+                key /= 2 * M + 1;
+            }
+        for (j = 1; j < K; j++)
+        {
+            for (i = 1, bal = 0; i < K; i++)    // Net #moves out of j
+                if (i != j)
+                    bal += v[tabPair[i][j]] * tabDir((unsigned char)j, (unsigned char)i);
+            if ( (bal > (int)M) || (bal < -(int)M) )
+                break;
+            v[tabPair[0][j]] = (signed char)bal;    // Moves 0 -> j
+        }
+        if (j < K)
+            continue;
+        key = tabKeyOf(v);
+        if (tabCanon(v, &perm) != key)
+            continue;                           // Not the canonical form of its class
+        if (N == cap)
+        {
+            cap = cap ? 2 * cap : 4096;
+            if ((t = (unsigned long long*)realloc(keys, cap * sizeof(unsigned long long))) == NULL)
+            {
+                free(keys);
+                puts("! Out of memory");
+                return EXIT_FAILURE;
+            }
+            keys = t;
+        }
+        keys[N++] = key;
+    }
+    qsort(keys, N, sizeof(unsigned long long), cmpTabKey);
+
+    // Max #cycles per entry, from the entries with fewer moves
+    val   = (unsigned short*)calloc(N, sizeof(unsigned short));
+    order = (unsigned*)malloc(N * sizeof(unsigned));
+    if ( (val == NULL) || (order == NULL) )
+    {
+        free(keys);
+        free(val);
+        free(order);
+        puts("! Out of memory");
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < N; i++)
+        order[i] = i;
+    tabSortKeys = keys;
+    qsort(order, N, sizeof(unsigned), cmpTabWeight);
+    for (i = 0; i < N; i++)
+    {
+        e = order[i];
+        tabUnpack(keys[e], v);
+        for (p = 0; (p < K * (K - 1) / 2) && !v[p]; p++);
+        if (p == K * (K - 1) / 2)
+            continue;                           // No moves: 0 cycles
+        for (c = 0; c < tabNcyc; c++)
+        {
+            for (j = 0; (j < tabLen[c]) && (tabPair[tabCyc[c][j]][tabCyc[c][(j + 1) % tabLen[c]]] != p); j++);
+            if ( (j == tabLen[c]) || !tabHolds(v, c) )
+                continue;                       // Not through the moves of pair p, or not in v
+            tabApply(v, c, 1);
+            j = tabFind(keys, N, tabCanon(v, &perm));
+            tabApply(v, c, -1);
+            if ( (j != TAB_MISS) && ((val[j] & 0xFF) + 1u > (val[e] & 0xFF)) )
+                val[e] = (unsigned short)(((val[j] & 0xFF) + 1) | (c << 8));
+        }
+        if (!(val[e] & 0xFF))
+        {
+            printf("! Residual %llx has no cycle\n", keys[e]);
+            break;
+        }
+    }
+    free(order);
+    if (i < N)
+    {
+        free(keys);
+        free(val);
+        return EXIT_FAILURE;
+    }
+
+    if ((fp = fopen(path, "wb")) == NULL)
+    {
+        printf("! Unable to use the path \"%s\"\n", path);
+        free(keys);
+        free(val);
+        return EXIT_FAILURE;
+    }
+    h.magic    = TAB_MAGIC;
+    h.version  = TAB_VERSION;
+    h.K        = K;
+    h.M        = M;
+    h.N        = N;
+    h.reserved = 0;
+    i = (fwrite(&h, sizeof(h), 1, fp) == 1) && (fwrite(keys, sizeof(unsigned long long), N, fp) == N)
+     && (fwrite(val, sizeof(unsigned short), N, fp) == N);
+    i = !fclose(fp) && i;
+    free(keys);
+    free(val);
+    if (!i)
+    {
+        printf("! Unable to write \"%s\"\n", path);
+        return EXIT_FAILURE;
+    }
+    printf("> Table of %u residuals of k <= %u, |W(i,j)| <= %u written to \"%s\"\n", N, K, M, path);
+    return EXIT_SUCCESS;
+}
+
+/** Unmap the table in use
+ * 261018 Created
+ */
+void tabFree()
+{
+    if (tabHdr != NULL)
+        UnmapViewOfFile(tabHdr);
+    if (tabMap != NULL)
+        CloseHandle(tabMap);
+    if ( (tabFile != NULL) && (tabFile != INVALID_HANDLE_VALUE) )
+        CloseHandle(tabFile);
+    tabHdr  = NULL;
+    tabMap  = tabFile = NULL;
+}
+
+/** Map the table of file path into memory, for getDecomp() to use on all threads
+ * Returns 0 if failed
+ * 261018 Created
+ */
+char tabLoad(const char *path)
+{
+    LARGE_INTEGER size;
+    const tabHeader *h;
+
+    tabFree();
+    if ((tabFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        printf("! Unable to use the path \"%s\"\n", path);
+        return 0;
+    }
+    if ( !GetFileSizeEx(tabFile, &size) || (size.QuadPart < (long long)sizeof(tabHeader))
+            || ((tabMap = CreateFileMappingA(tabFile, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL)
+            || ((h = (const tabHeader*)MapViewOfFile(tabMap, FILE_MAP_READ, 0, 0, 0)) == NULL) )
+    {
+        printf("! Unable to map \"%s\"\n", path);
+        tabFree();
+        return 0;
+    }
+    tabHdr = h;
+    if ( (h->magic != TAB_MAGIC) || (h->version != TAB_VERSION) || (h->K < 2) || (h->K > TAB_MAX_K)
+            || (h->M < 1) || (h->M > TAB_MAX_M)
+            || ((unsigned long long)size.QuadPart != sizeof(tabHeader) + (unsigned long long)h->N * (sizeof(unsigned long long) + sizeof(unsigned short))) )
+    {
+        printf("! \"%s\" is not a decomposition table\n", path);
+        tabFree();
+        return 0;
+    }
+    tabInit(h->K);
+    tabKey = (const unsigned long long*)(h + 1);
+    tabVal = (const unsigned short*)(tabKey + h->N);
+    return 1;
+}
+
+/** If the rest of W is a residual of the table in use, remove the cycles of its optimal
+ * decomposition from W, logged as getDecomp() does
+ * Returns the #cycles removed, or TAB_MISS if the table does not hold W
+ * 261018 Created
+ */
+unsigned tabSolve()
+{
+    unsigned i, j, a, b, t, e, c, perm, Na = 0, Nc = 0;
+    unsigned nd[TAB_MAX_K];                 // Stars of W with moves
+    unsigned char inv[TAB_MAX_K];           // inv[s] = index in nd of star s of the canonical form
+    signed char v[TAB_NP];
+    int d;
+
+    if (tabHdr == NULL)
+        return TAB_MISS;
+    for (i = 0; i < k; i++)
+    {
+        for (j = 0; (j < k) && ((j == i) || (!W[i][j] && !W[j][i])); j++);
+        if (j == k)
+            continue;
+        if (Na == tabK)
+            return TAB_MISS;                // Too many stars
+        nd[Na++] = i;
+    }
+    for (; Na < tabK; Na++)
+        nd[Na] = EOC;                       // No star
+    for (a = 0; a < tabK; a++)
+        for (b = a + 1; b < tabK; b++)
+        {
+            if (nd[b] == EOC)
+            {
+                v[tabPair[a][b]] = 0;
+                continue;
+            }
+            if (W[nd[a]][nd[b]] && W[nd[b]][nd[a]])
+                return TAB_MISS;            // 2-cycle
+            d = (int)W[nd[a]][nd[b]] - (int)W[nd[b]][nd[a]];
+            if ( (d > (int)tabHdr->M) || (d < -(int)tabHdr->M) )
+                return TAB_MISS;
+            v[tabPair[a][b]] = (signed char)d;
+        }
+
+    for (;;)
+    {
+        if ((e = tabFind(tabKey, tabHdr->N, tabCanon(v, &perm))) == TAB_MISS)
+        {
+            if (Nc)
+                anomaly(ERR_NO_CYCLE, "! Table: residual missing\n");
+            return Nc ? Nc : TAB_MISS;
+        }
+        if (!(tabVal[e] & 0xFF))
+            return Nc;                      // W is empty
+        c = tabVal[e] >> 8;
+        for (a = 0; a < tabK; a++)
+            inv[tabPerm[perm][a]] = (unsigned char)a;
+        for (t = 0; t < tabLen[c]; t++)
+            cycle[t] = nd[inv[tabCyc[c][t]]];
+        for (t = 0; t < tabLen[c]; t++)
+        {
+            a = inv[tabCyc[c][t]];
+            b = inv[tabCyc[c][(t + 1) % tabLen[c]]];
+            decW(nd[a], nd[b]);
+            v[tabPair[a][b]] -= tabDir((unsigned char)a, (unsigned char)b);
+        }
+        if (cycRec)
+            logCycle(cycle, tabLen[c], 0);
+        OP_CYC(tabLen[c]);
+        Nc++;
+    }
+}
@@ -0,0 +1,223 @@
+/** Event tracer: timestamped events of the solver in a ring buffer per thread, exported as Chrome
+ * trace-event JSON (chrome://tracing, ui.perfetto.dev) to see where the time and depth of a run go
+ *
+ * Events: spans of the phases (instance, router, getDecomp(), kernelize(), delCycles(), the items
+ * of a pool thread), stage boundaries, swaps and cycle removals. Each thread only writes its own
+ * ring, so no lock or atomic is taken per event; the rings are registered once per thread. When a
+ * ring is full, its oldest events are overwritten. Export the rings once the traced threads, other
+ * than the calling thread, have ended (batch runs: -T).
+ *
+ * The tracer is only compiled in if TRACE is defined; otherwise TR_*() are empty and cost nothing.
+ * Compiled in, the events are only recorded after trStart().
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+//#define TRACE                         // Compile the tracer in (see TR_*)
+
+enum {TE_BEGIN, TE_END,                 // Span begins, ends
+      TE_STAGE,                         // New stage
+      TE_SWAP,                          // Swap
+      TE_CYCLE};                        // Cycle(s) removed
+
+enum {TN_INSTANCE,                      // Names of the spans
+      TN_SIMPLE, TN_STAGES, TN_CYCLES,  // Routers
+      TN_DECOMP, TN_KERNELIZE, TN_DEL_CYCLES,
+      TN_PAR,                           // Items of a generation of the pool
+      NTN};
+
+#ifdef TRACE
+#define TR_CAP          (1u << 18)      // Default #events per ring; a power of 2
+#define TR_MAX_RINGS    256             // Max #threads traced
+
+static const char *trName[NTN] = {"instance", "routeSimple", "routeStages", "routeCycles",
+                                  "getDecomp", "kernelize", "delCycles", "par"};
+static const char *trArg[NTN]  = {"seed", NULL, NULL, NULL, NULL, NULL, "len", "tid"};
+
+typedef struct
+{
+    unsigned long long t;               // Time [ns] (nsNow())
+    unsigned a, b, d;                   // Arguments: span (a, b: 64-bit), swap (i, j, stage d),
+                                        // stage (d), cycles (length a, #cycles b)
+    unsigned char type;                 // TE_*
+    unsigned char name;                 // TN_* of a span
+} trEvent;
+
+typedef struct
+{
+    trEvent  *ev;
+    unsigned cap;                       // #events of ev; 0: not traced
+    unsigned long long head;            // #events written
+} trRing;
+
+char trOn;                              // Record events
+static unsigned trCap = TR_CAP;
+static unsigned long long trT0;         // Time of trStart()
+static trRing *trRings[TR_MAX_RINGS];
+static volatile LONG trNRings;          // #rings registered, also if > TR_MAX_RINGS
+static unsigned trGen = 1;              // Generation of the rings: incremented by trExport(), which frees them
+static TLS trRing *trMine;              // Ring of this thread
+static TLS unsigned trMineGen;          // Generation of trMine; another one: trMine was freed
+static trRing trNone;                   // Ring of the threads that are not traced
+
+#define TR_BEGIN(nm, a)     (trOn ? trPut(TE_BEGIN, nm, (unsigned)(a), (unsigned)((unsigned long long)(a) >> 32), 0) : (void)0)
+#define TR_END(nm)          (trOn ? trPut(TE_END, nm, 0, 0, 0) : (void)0)
+#define TR_STAGE()          (trOn ? trPut(TE_STAGE, 0, 0, 0, depth) : (void)0)
+#define TR_SWAP(i, j)       (trOn ? trPut(TE_SWAP, 0, i, j, depth) : (void)0)
+#define TR_CYCLE(len, N)    ((trOn && (N)) ? trPut(TE_CYCLE, 0, len, N, 0) : (void)0)
+
+/** Start to record events, in rings of cap events per thread (rounded up to a power of 2; 0: TR_CAP)
+ * 261018 Created
+ */
+void trStart(unsigned cap)
+{
+    for (trCap = 1; trCap < cap; trCap <<= 1);
+    if (cap == 0)
+        trCap = TR_CAP;
+    trT0 = nsNow();
+    trOn = 1;
+}
+
+/** Register the ring of this thread
+ * Returns the ring; trNone if out of rings or memory
+ * 261018 Created
+ * 261018 Keep the generation of the ring
+ */
+static trRing *trAttach()
+{
+    const LONG i = InterlockedIncrement(&trNRings) - 1;
+    trRing *r;
+
+    trMine    = &trNone;
+    trMineGen = trGen;
+    if (i >= TR_MAX_RINGS)
+        return trMine;
+    if ((r = (trRing*)calloc(1, sizeof(trRing))) == NULL)
+        return trMine;
+    if ((r->ev = (trEvent*)malloc((size_t)trCap * sizeof(trEvent))) == NULL)
+    {
+        free(r);
+        return trMine;
+    }
+    r->cap = trCap;
+    trRings[i] = r;
+    return (trMine = r);
+}
+
+/** Record an event of type with name and arguments a, b, d in the ring of this thread
+ * 261018 Created
+ * 261018 Attach a new ring if the one of this thread was freed by trExport()
+ */
+static void trPut(const unsigned char type, const unsigned char name, const unsigned a, const unsigned b, const unsigned d)
+{
+    trRing *r = (trMine && (trMineGen == trGen)) ? trMine : trAttach();
+    trEvent *e;
+
+    if (r->cap == 0)
+        return;
+    e = &r->ev[r->head & (r->cap - 1)];
+    e->t    = nsNow();
+    e->a    = a;
+    e->b    = b;
+    e->d    = d;
+    e->type = type;
+    e->name = name;
+    r->head++;
+}
+
+/** Stop recording, write the events of all rings as Chrome trace-event JSON to file path, and free
+ * the rings. No thread may trace meanwhile. mm is the #leafs/centre of the traced swaps.
+ * The end of a span of which the begin was overwritten in a full ring is left out.
+ * Returns 0 if failed
+ * 261018 Created
+ * 261018 Pass m; drop unmatched span ends; a new generation of rings for the threads that live on
+ */
+char trExport(const char *path, const unsigned mm)
+{
+    unsigned i, Nr, Nopen;
+    unsigned long long h, Ne = 0, Nlost = 0, Ndrop = 0;
+    char sep = ' ';
+    const trEvent *e;
+    trRing *r;
+    FILE *fp;
+
+    trOn = 0;
+    Nr = (trNRings < TR_MAX_RINGS) ? (unsigned)trNRings : TR_MAX_RINGS;
+    if ((fp = fopen(path, "w")) == NULL)
+    {
+        printf("! Unable to use the path \"%s\"\n", path);
+        return 0;
+    }
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", fp);
+    for (i = 0; i < Nr; i++)
+    {
+        if ((r = trRings[i]) == NULL)
+            continue;
+        fprintf(fp, "%c{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}\n", sep, i, i);
+        sep = ',';
+        h = (r->head > r->cap) ? r->head - r->cap : 0;   // Oldest event kept
+        Nlost += h;
+        for (Nopen = 0; h < r->head; h++)
+        {
+            e = &r->ev[h & (r->cap - 1)];
+            if (e->type == TE_BEGIN)
+                Nopen++;
+            else if (e->type == TE_END)
+            {
+                if (Nopen == 0)
+                {
+                    Ndrop++;                // Its begin was overwritten
+                    continue;
+                }
+                Nopen--;
+            }
+            Ne++;
+            fprintf(fp, ",{\"pid\":1,\"tid\":%u,\"ts\":%.3f,", i, (double)(e->t - trT0) / 1e3);
+            switch (e->type)
+            {
+            case TE_BEGIN:
+                fprintf(fp, "\"ph\":\"B\",\"cat\":\"phase\",\"name\":\"%s\"", trName[e->name]);
+                if (trArg[e->name] != NULL)
+                    fprintf(fp, ",\"args\":{\"%s\":%llu}", trArg[e->name], ((unsigned long long)e->b << 32) | e->a);
+                break;
+            case TE_END:
+                fprintf(fp, "\"ph\":\"E\",\"cat\":\"phase\",\"name\":\"%s\"", trName[e->name]);
+                break;
+            case TE_STAGE:
+                fprintf(fp, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"route\",\"name\":\"stage\",\"args\":{\"d\":%u}", e->d);
+                break;
+            case TE_SWAP:
+                fprintf(fp, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"route\",\"name\":\"%s\",\"args\":{\"i\":%u,\"j\":%u,\"d\":%u}",
+                        ((e->a % (mm+1)) || (e->b % (mm+1))) ? "swapCheap" : "swapExp", e->a, e->b, e->d);
+                break;
+            case TE_CYCLE:
+                fprintf(fp, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"decomp\",\"name\":\"cycle\",\"args\":{\"len\":%u,\"n\":%u}", e->a, e->b);
+                break;
+            }
+            fputs("}\n", fp);
+        }
+        free(r->ev);
+        free(r);
+        trRings[i] = NULL;
+    }
+    fputs("]}\n", fp);
+    fclose(fp);
+    trNRings = 0;
+    trMine   = NULL;
+    trGen++;
+    printf("> Trace: %llu events of %u threads written to \"%s\"", Ne, Nr, path);
+    if (Nlost)
+        printf(", %llu oldest events overwritten", Nlost);
+    if (Ndrop)
+        printf(", %llu span ends without begin left out", Ndrop);
+    puts("");
+    return 1;
+}
+#else
+#define TR_BEGIN(nm, a)     ((void)0)
+#define TR_END(nm)          ((void)0)
+#define TR_STAGE()          ((void)0)
+#define TR_SWAP(i, j)       ((void)0)
+#define TR_CYCLE(len, N)    ((void)0)
+#endif // TRACE
@@ -0,0 +1,231 @@
+/** Replay and verify a recorded swap schedule
+ *
+ * verifySched() applies a schedule to x0 and checks it in 1 pass over the swaps:
+ *   - the stages are in order (the routers record them in order),
+ *   - the swaps of a stage are disjoint: a node is in at most 1 swap per stage (stamp per node),
+ *   - each swap is on an edge of the fully connected star graph: a leaf and its own centre,
+ *     or 2 centres,
+ *   - the final state equals y (VERIFY_EXACT), or each label is in the star of its node in y
+ *     (VERIFY_STAR: the routers route to the star level).
+ * It recounts depth (#stages with swaps), Ns and Nsb from the schedule.
+ * The swaps of a stage are disjoint, so a stage is applied as 1 gather of its labels followed by
+ * 1 scatter, per label width, without a dependency between the swaps.
+ *
+ * Created by J. Keur
+ * 261018
+ */
+
+#define VERIFY_CHUNK    64              // #swaps of a stage gathered at a time
+#define VERIFY_STAR     0               // Check the final state on the star level
+#define VERIFY_EXACT    1               // Check that the final state equals y
+#define POST_COMPACT    1               // routeRecorded(): compact the schedule
+#define POST_VERIFY     2               // routeRecorded(): verify the schedule
+
+static TLS unsigned *vStamp;            // vStamp[i] = 1 + stage of the last swap of node i
+static TLS unsigned *vDest;             // vDest[l] = star of label l in y
+static TLS unsigned vStampCap;
+static TLS swapRec  *vSched;            // Schedule buffer of routeRecorded()
+static TLS unsigned vSchedCap;
+
+/** Apply the disjoint swaps s[0], .., s[N-1] to the 16-bit labels xs
+ * 261018 Created
+ */
+static void applySwaps16(lab16 *xs, const swapRec *s, const unsigned N)
+{
+    lab16 li[VERIFY_CHUNK], lj[VERIFY_CHUNK];
+    unsigned a, b, c;
+
+    for (a = 0; a < N; a += VERIFY_CHUNK)
+    {
+        c = N - a < VERIFY_CHUNK ? N - a : VERIFY_CHUNK;
+        for (b = 0; b < c; b++)         // Gather
+        {
+            li[b] = xs[s[a+b].i];
+            lj[b] = xs[s[a+b].j];
+        }
+        for (b = 0; b < c; b++)         // Scatter
+        {
+            xs[s[a+b].i] = lj[b];
+            xs[s[a+b].j] = li[b];
+        }
+    }
+}
+
+/** Apply the disjoint swaps s[0], .., s[N-1] to the 32-bit labels xs
+ * 261018 Created
+ */
+static void applySwaps32(unsigned *xs, const swapRec *s, const unsigned N)
+{
+    unsigned li[VERIFY_CHUNK], lj[VERIFY_CHUNK];
+    unsigned a, b, c;
+
+    for (a = 0; a < N; a += VERIFY_CHUNK)
+    {
+        c = N - a < VERIFY_CHUNK ? N - a : VERIFY_CHUNK;
+        for (b = 0; b < c; b++)
+        {
+            li[b] = xs[s[a+b].i];
+            lj[b] = xs[s[a+b].j];
+        }
+        for (b = 0; b < c; b++)
+        {
+            xs[s[a+b].i] = lj[b];
+            xs[s[a+b].j] = li[b];
+        }
+    }
+}
+
+/** Test if each label of x is in the star of its node in y
+ * 261018 Created
+ */
+static char starSorted()
+{
+    unsigned i, g;
+
+    for (i = 0; i <= n; i++)
+        vDest[i] = UINT_MAX;
+    for (i = 0; i < n; i++)
+        vDest[LAB(y, i)] = i/(m+1);
+    for (g = 0, i = 0; i < n; g++)
+        for (; i < (g + 1) * (m+1); i++)
+            if (vDest[LAB(x, i)] != g)
+                return 0;
+    return 1;
+}
+
+/** Replay the schedule s of Nsw swaps on x0 into x and verify it; the final state is checked
+ * on level (VERIFY_STAR, VERIFY_EXACT).
+ * The recounted depth, Ns and Nsb are stored in *vDepth, *vNs, *vNsb (if not NULL).
+ * Returns ERR_NONE if the schedule is valid and sorts x0 to y, otherwise the ERR_SCHED_* code
+ * 261018 Created
+ */
+char verifySched(const swapRec *s, const unsigned Nsw, const char level, unsigned *vDepth, unsigned *vNs, unsigned *vNsb)
+{
+    unsigned p, p0, i, j, ri, rj, d, dep = 0, Nb = 0;
+    const unsigned m1 = m + 1;
+    char err = ERR_NONE;
+
+    if (vStampCap < n)
+    {
+        free(vStamp);
+        free(vDest);
+        vStampCap = 0;
+        vStamp = (unsigned*)malloc(n * sizeof(unsigned));
+        vDest  = (unsigned*)malloc((n + 1) * sizeof(unsigned));
+        if (!vStamp || !vDest)
+            return ERR_NO_MEM;
+        vStampCap = n;
+    }
+    memset(vStamp, 0, n * sizeof(unsigned));
+    memcpy(x, x0, n * labW);
+
+    for (p0 = 0; (p0 < Nsw) && (err == ERR_NONE); p0 = p)
+    {
+        d = s[p0].d;
+        if ( (p0 > 0) && (d <= s[p0-1].d) )
+        {
+            err = ERR_SCHED_ORDER;
+            break;
+        }
+        dep++;
+        for (p = p0; (p < Nsw) && (s[p].d == d); p++)   // Check the swaps of stage d
+        {
+            i = s[p].i;
+            j = s[p].j;
+            if ( (i >= n) || (j >= n) || (i == j) )
+            {
+                err = ERR_SCHED_EDGE;
+                break;
+            }
+            if ( (vStamp[i] == d + 1) || (vStamp[j] == d + 1) )
+            {
+                err = ERR_SCHED_CONFLICT;
+                break;
+            }
+            vStamp[i] = d + 1;
+            vStamp[j] = d + 1;
+            ri = i % m1;
+            rj = j % m1;
+            if ( (ri == 0) && (rj == 0) )
+                Nb++;                   // Centre-centre
+            else if ( ((ri != 0) && (rj != 0)) || (i/m1 != j/m1) )
+            {
+                err = ERR_SCHED_EDGE;   // Leaf-leaf, or a leaf and another centre
+                break;
+            }
+        }
+        if (err != ERR_NONE)
+            break;
+        if (labW == 2)
+            applySwaps16((lab16*)x, &s[p0], p - p0);
+        else
+            applySwaps32((unsigned*)x, &s[p0], p - p0);
+    }
+    if ( (err == ERR_NONE) && ((level == VERIFY_EXACT) ? memcmp(x, y, n * labW) != 0 : !starSorted()) )
+        err = ERR_NOT_SORTED;
+
+    if (vDepth)
+        *vDepth = dep;
+    if (vNs)
+        *vNs = Nsw;
+    if (vNsb)
+        *vNsb = Nb;
+    return err;
+}
+
+/** Verify the recorded schedule s of Nsw swaps of the last route() on the star level, and its
+ * depth, Ns, Nsb. A failed check is registered as an anomaly.
+ * 261018 Created
+ */
+void verifyRecorded(const swapRec *s, const unsigned Nsw)
+{
+    unsigned vDepth, vNs, vNsb;
+    char err;
+
+    if ((err = verifySched(s, Nsw, VERIFY_STAR, &vDepth, &vNs, &vNsb)) != ERR_NONE)
+        anomaly(err, "! Verify: %s\n", errName[(int)err]);
+    else if ( (vDepth != depth) || (vNs != Ns) || (vNsb != Nsb) )
+        anomaly(ERR_SCHED_COUNT, "! Verify: counted d %u, Ns %u, Nsb %u; replayed d %u, Ns %u, Nsb %u\n",
+                depth, Ns, Nsb, vDepth, vNs, vNsb);
+}
+
+/** Run the router of alg with its swaps recorded, compact its stages if post has POST_COMPACT
+ * (compactSched()), and verify its schedule on the star level and its depth, Ns, Nsb if post has
+ * POST_VERIFY. A failed check is registered as an anomaly.
+ * Returns the result of route()
+ * 261018 Created
+ * 261018 Compact the schedule
+ */
+unsigned routeRecorded(const char alg, const char post)
+{
+    unsigned beta, Nsw;
+    swapRec *p;
+
+    if ( (vSchedCap < 2 * n) && (p = (swapRec*)realloc(vSched, 2 * n * sizeof(swapRec))) != NULL )
+    {
+        vSched    = p;
+        vSchedCap = 2 * n;
+    }
+    recordSwaps(vSched, vSchedCap);
+    beta = route(alg);
+    if ( (Nrec > vSchedCap) && !GIVE_UP )  // Schedule did not fit: grow the buffer and route again
+    {
+        if ((p = (swapRec*)realloc(vSched, Nrec * sizeof(swapRec))) == NULL)
+        {
+            recordSwaps(NULL, 0);
+            anomaly(ERR_NO_MEM, "! Verify: out of memory\n");
+            return beta;
+        }
+        vSched    = p;
+        vSchedCap = Nrec;
+        recordSwaps(vSched, vSchedCap);
+        beta = route(alg);
+    }
+    Nsw = Nrec;
+    recordSwaps(NULL, 0);
+    if ( (post & POST_COMPACT) && !GIVE_UP )
+        compactSched(vSched, Nsw);
+    if ( (post & POST_VERIFY) && !GIVE_UP )
+        verifyRecorded(vSched, Nsw);
+    return beta;
+}